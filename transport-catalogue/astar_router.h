@@ -0,0 +1,163 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+//Движок без предрасчета: каждый запрос отвечается поиском A*.
+//lower_bound(vertex, to) - нижняя оценка веса пути от vertex до to. Оценка должна быть
+//согласованной: lower_bound(u, to) <= weight(u -> v) + lower_bound(v, to) для любого ребра,
+//тогда найденный маршрут оптимален, а вершин просматривается меньше, чем у Дейкстры
+template <typename Weight>
+class AStarRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterEngine<Weight>::RouteInfo;
+    using LowerBound = std::function<Weight(VertexId vertex, VertexId to)>;
+
+    AStarRouter(const Graph& graph, LowerBound lower_bound);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    //Одно дерево Дейкстры из from, растущее до тех пор, пока не достигнуты все цели:
+    //оценка A* направляет поиск только к одной цели
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override;
+
+    size_t GetMemoryFootprint() const override;
+
+protected:
+    //Только веса: одно дерево Дейкстры из from, без восстановления ребер маршрута
+    std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from,
+                                                           const std::vector<VertexId>& targets) const override;
+
+private:
+    struct QueueItem {
+        Weight estimate;  //Вес пути до вершины плюс нижняя оценка остатка
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return estimate > other.estimate;
+        }
+    };
+
+    //Поиск A* из from до извлечения to. Возвращает вес маршрута; последние ребра путей
+    //пишутся в prev_edges, если он передан
+    std::optional<Weight> FindRouteWeight(VertexId from, VertexId to,
+                                          std::vector<std::optional<EdgeId>>* prev_edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    LowerBound lower_bound_;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, LowerBound lower_bound)
+    : graph_(graph)
+    , lower_bound_(std::move(lower_bound)) {
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<Weight> AStarRouter<Weight>::FindRouteWeight(VertexId from, VertexId to,
+                                                           std::vector<std::optional<EdgeId>>* prev_edges) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    if (prev_edges) {
+        prev_edges->assign(vertex_count, std::nullopt);
+    }
+
+    weights[from] = ZERO_WEIGHT;
+    queue.push({lower_bound_(from, to), ZERO_WEIGHT, from});
+
+    while (!queue.empty()) {
+        const auto [estimate, weight, vertex] = queue.top();
+        queue.pop();
+
+        //Устаревшая запись: вершина уже достигнута более коротким путем
+        if (*weights[vertex] < weight) {
+            continue;
+        }
+
+        if (vertex == to) {
+            break;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const VertexId target = edge.to;
+            const Weight candidate_weight = weight + edge.weight;
+
+            if (!weights[target] || candidate_weight < *weights[target]) {
+                weights[target] = candidate_weight;
+                if (prev_edges) {
+                    (*prev_edges)[target] = edge_id;
+                }
+                queue.push({candidate_weight + lower_bound_(target, to), candidate_weight, target});
+            }
+        }
+    }
+
+    return weights[to];
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    std::vector<std::optional<EdgeId>> prev_edges;
+    const auto weight = FindRouteWeight(from, to, &prev_edges);
+    if (!weight) {
+        return std::nullopt;
+    }
+
+    return RouteInfo{*weight, CollectRouteEdges(graph_, prev_edges, to)};
+}
+
+template <typename Weight>
+std::vector<std::optional<typename AStarRouter<Weight>::RouteInfo>>
+AStarRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    //Для одной цели A* просматривает меньше вершин, чем дерево Дейкстры
+    if (targets.size() == 1) {
+        std::vector<std::optional<RouteInfo>> routes;
+        routes.push_back(BuildRoute(from, targets.front()));
+        return routes;
+    }
+
+    return BuildRoutesFromTree(graph_, from, targets);
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> AStarRouter<Weight>::ComputeRouteWeights(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    return ComputeTreeWeights(graph_, from, targets);
+}
+
+template <typename Weight>
+size_t AStarRouter<Weight>::GetMemoryFootprint() const {
+    //Между запросами движок ничего не хранит, размер данных внутри lower_bound_ ему неизвестен
+    return 0;
+}
+}  // namespace graph
@@ -0,0 +1,322 @@
+#include "catalogue_snapshot.h"
+
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace catalogue_snapshot {
+namespace {
+using routing_index::Checksum;
+using routing_index::FileBuilder;
+using routing_index::MappedFile;
+using routing_index::Section;
+
+//Узел JSON в двоичном виде: тип, затем значение. Строки - длина и байты, массивы и словари -
+//число элементов и сами элементы
+enum class NodeType : uint8_t {
+    NULL_VALUE,
+    ARRAY,
+    DICT,
+    BOOL,
+    INT,
+    DOUBLE,
+    STRING,
+};
+
+template <typename Value>
+void AppendValue(std::string& out, const Value& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(std::string& out, std::string_view str) {
+    AppendValue(out, static_cast<uint64_t>(str.size()));
+    out.append(str);
+}
+
+void AppendNode(std::string& out, const json::Node& node) {
+    if (node.IsNull()) {
+        AppendValue(out, NodeType::NULL_VALUE);
+    } else if (node.IsArray()) {
+        AppendValue(out, NodeType::ARRAY);
+        AppendValue(out, static_cast<uint64_t>(node.AsArray().size()));
+        for (const auto& item : node.AsArray()) {
+            AppendNode(out, item);
+        }
+    } else if (node.IsDict()) {
+        AppendValue(out, NodeType::DICT);
+        AppendValue(out, static_cast<uint64_t>(node.AsDict().size()));
+        for (const auto& [key, value] : node.AsDict()) {
+            AppendString(out, key);
+            AppendNode(out, value);
+        }
+    } else if (node.IsBool()) {
+        AppendValue(out, NodeType::BOOL);
+        AppendValue(out, static_cast<uint8_t>(node.AsBool()));
+    } else if (node.IsInt()) {
+        AppendValue(out, NodeType::INT);
+        AppendValue(out, static_cast<int64_t>(node.AsInt()));
+    } else if (node.IsPureDouble()) {
+        AppendValue(out, NodeType::DOUBLE);
+        AppendValue(out, node.AsDouble());
+    } else {
+        AppendValue(out, NodeType::STRING);
+        AppendString(out, node.AsString());
+    }
+}
+
+//Читает узлы, записанные AppendNode. Выход за пределы буфера - исключение std::out_of_range
+class NodeReader {
+public:
+    NodeReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    json::Node ReadNode() {
+        switch (ReadValue<NodeType>()) {
+            case NodeType::NULL_VALUE:
+                return json::Node(nullptr);
+            case NodeType::ARRAY: {
+                json::Array array;
+                for (uint64_t count = ReadValue<uint64_t>(); count > 0; --count) {
+                    array.push_back(ReadNode());
+                }
+                return json::Node(std::move(array));
+            }
+            case NodeType::DICT: {
+                json::Dict dict;
+                for (uint64_t count = ReadValue<uint64_t>(); count > 0; --count) {
+                    std::string key = ReadString();
+                    dict.emplace(std::move(key), ReadNode());
+                }
+                return json::Node(std::move(dict));
+            }
+            case NodeType::BOOL:
+                return json::Node(ReadValue<uint8_t>() != 0);
+            case NodeType::INT:
+                return json::Node(static_cast<int>(ReadValue<int64_t>()));
+            case NodeType::DOUBLE:
+                return json::Node(ReadValue<double>());
+            case NodeType::STRING:
+                return json::Node(ReadString());
+        }
+        throw std::out_of_range("Unknown node type"s);
+    }
+
+    bool AtEnd() const {
+        return position_ == size_;
+    }
+
+private:
+    const char* Take(uint64_t size) {
+        if (size > size_ - position_) {
+            throw std::out_of_range("Node is out of section"s);
+        }
+
+        const char* result = data_ + position_;
+        position_ += size;
+        return result;
+    }
+
+    template <typename Value>
+    Value ReadValue() {
+        Value value;
+        std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string ReadString() {
+        const uint64_t size = ReadValue<uint64_t>();
+        const char* data = Take(size);
+        return std::string(data, size);
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+uint64_t ComputeBodyChecksum(const char* data, size_t size) {
+    Checksum checksum;
+    checksum.Add(data + sizeof(Header), size - sizeof(Header));
+    return checksum.Get();
+}
+
+//Секция как массив записей: nullptr, если она выходит за пределы файла или размер не кратен записи
+template <typename Record>
+const Record* GetRecords(const MappedFile& file, const Section& section) {
+    const char* data = file.GetSection(section);
+    if (!data || section.size % sizeof(Record) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const Record*>(data);
+}
+}  // namespace
+
+void Save(const TransportCatalogue& catalogue, const json::Node& settings, const std::string& path) {
+    FileBuilder builder(sizeof(Header));
+
+    std::string strings;
+    auto add_string = [&strings](std::string_view str) {
+        const uint64_t offset = strings.size();
+        strings += str;
+        return offset;
+    };
+
+    std::vector<StopRecord> stops;
+    stops.reserve(catalogue.GetStopsCount());
+    for (domain::StopId stop_id = 0; stop_id < catalogue.GetStopsCount(); ++stop_id) {
+        const domain::Stop* stop = catalogue.FindStop(stop_id);
+        stops.push_back({add_string(stop->name_stop), stop->name_stop.size(),
+                         stop->coordinates.lat, stop->coordinates.lng});
+    }
+
+    std::vector<BusRecord> buses;
+    std::vector<domain::StopId> bus_stops;
+    buses.reserve(catalogue.GetBusesCount());
+    for (const domain::Bus* bus : catalogue.GetBuses(true)) {
+        const auto& stats = catalogue.GetBusStats(bus->id);
+        buses.push_back({add_string(bus->name_bus), bus->name_bus.size(), bus_stops.size(),
+                         bus->stops_for_bus.size(), bus->is_roundtrip,
+                         static_cast<uint64_t>(stats.unique_stops), stats.route_length, stats.geo_length});
+
+        for (const domain::Stop* stop : bus->stops_for_bus) {
+            bus_stops.push_back(stop->id);
+        }
+    }
+
+    std::vector<DistanceRecord> distances;
+    for (const auto& [stop_from, stop_to, distance] : catalogue.GetDistances()) {
+        distances.push_back({stop_from, stop_to, distance});
+    }
+
+    std::string settings_data;
+    AppendNode(settings_data, settings);
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.strings = builder.AddSection(strings.data(), strings.size());
+    header.stops = builder.AddSection(stops.data(), stops.size() * sizeof(StopRecord));
+    header.buses = builder.AddSection(buses.data(), buses.size() * sizeof(BusRecord));
+    header.bus_stops = builder.AddSection(bus_stops.data(), bus_stops.size() * sizeof(domain::StopId));
+    header.distances = builder.AddSection(distances.data(), distances.size() * sizeof(DistanceRecord));
+    header.settings = builder.AddSection(settings_data.data(), settings_data.size());
+    header.file_size = builder.GetSize();
+    header.checksum = ComputeBodyChecksum(builder.GetData(), builder.GetSize());
+
+    builder.GetHeaderAs<Header>() = header;
+    builder.Write(path);
+}
+
+bool Load(const std::string& path, TransportCatalogue& catalogue, json::Node& settings) {
+    if (catalogue.GetStopsCount() != 0 || catalogue.GetBusesCount() != 0) {
+        throw std::invalid_argument("Snapshot should be loaded into an empty catalogue"s);
+    }
+
+    MappedFile file(path);
+    if (!file.IsOpen() || file.GetSize() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.GetData(), sizeof(Header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        || header.version != FORMAT_VERSION
+        || header.header_size != sizeof(Header)
+        || header.file_size != file.GetSize()
+        || header.checksum != ComputeBodyChecksum(file.GetData(), file.GetSize())) {
+        return false;
+    }
+
+    const char* strings = file.GetSection(header.strings);
+    const auto* stops = GetRecords<StopRecord>(file, header.stops);
+    const auto* buses = GetRecords<BusRecord>(file, header.buses);
+    const auto* bus_stops = GetRecords<domain::StopId>(file, header.bus_stops);
+    const auto* distances = GetRecords<DistanceRecord>(file, header.distances);
+    const char* settings_data = file.GetSection(header.settings);
+    if (!strings || !stops || !buses || !bus_stops || !distances || !settings_data) {
+        return false;
+    }
+
+    const size_t stop_count = header.stops.size / sizeof(StopRecord);
+    const size_t bus_count = header.buses.size / sizeof(BusRecord);
+    const size_t bus_stop_count = header.bus_stops.size / sizeof(domain::StopId);
+    const size_t distance_count = header.distances.size / sizeof(DistanceRecord);
+
+    auto read_string = [&header, strings](uint64_t offset, uint64_t size) -> std::optional<std::string_view> {
+        if (offset > header.strings.size || size > header.strings.size - offset) {
+            return std::nullopt;
+        }
+        return std::string_view(strings + offset, size);
+    };
+
+    //Все записи проверяются до изменения справочника
+    for (size_t i = 0; i < stop_count; ++i) {
+        if (!read_string(stops[i].name_offset, stops[i].name_size)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < bus_count; ++i) {
+        if (!read_string(buses[i].name_offset, buses[i].name_size)
+            || buses[i].first_stop > bus_stop_count
+            || buses[i].stop_count > bus_stop_count - buses[i].first_stop) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < bus_stop_count; ++i) {
+        if (bus_stops[i] >= stop_count) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < distance_count; ++i) {
+        if (distances[i].stop_from >= stop_count || distances[i].stop_to >= stop_count) {
+            return false;
+        }
+    }
+
+    json::Node loaded_settings;
+    try {
+        NodeReader reader(settings_data, header.settings.size);
+        loaded_settings = reader.ReadNode();
+        if (!reader.AtEnd()) {
+            return false;
+        }
+    } catch (const std::out_of_range&) {
+        return false;
+    }
+
+    std::vector<domain::Stop> catalogue_stops(stop_count);
+    for (size_t i = 0; i < stop_count; ++i) {
+        catalogue_stops[i].name_stop = std::string(*read_string(stops[i].name_offset, stops[i].name_size));
+        catalogue_stops[i].coordinates = {stops[i].lat, stops[i].lng};
+    }
+
+    std::vector<TransportCatalogue::FrozenBus> catalogue_buses;
+    catalogue_buses.reserve(bus_count);
+    for (size_t i = 0; i < bus_count; ++i) {
+        const TransportCatalogue::BusStats stats{static_cast<int>(buses[i].stop_count),
+                                                 static_cast<int>(buses[i].unique_stops),
+                                                 buses[i].route_length, buses[i].geo_length};
+        catalogue_buses.push_back({std::string(*read_string(buses[i].name_offset, buses[i].name_size)),
+                                   buses[i].first_stop, buses[i].stop_count, buses[i].is_roundtrip != 0, stats});
+    }
+
+    std::vector<domain::RoadDistance> catalogue_distances;
+    catalogue_distances.reserve(distance_count);
+    for (size_t i = 0; i < distance_count; ++i) {
+        catalogue_distances.push_back({distances[i].stop_from, distances[i].stop_to, distances[i].distance});
+    }
+
+    catalogue.LoadFrozen(std::move(catalogue_stops), std::move(catalogue_buses),
+                         std::vector<domain::StopId>(bus_stops, bus_stops + bus_stop_count), catalogue_distances);
+
+    settings = std::move(loaded_settings);
+    return true;
+}
+}  // namespace catalogue_snapshot
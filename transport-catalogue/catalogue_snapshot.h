@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "json.h"
+#include "routing_index.h"
+#include "transport_catalogue.h"
+
+//Двоичный снимок справочника, который загружается вместо разбора base_requests.
+//Файл отображается в память; формат - заголовок и секции, выровненные как в routing_index:
+//  строки      - имена остановок и маршрутов подряд, записи ссылаются на них смещением;
+//  остановки   - StopRecord в порядке StopId;
+//  маршруты    - BusRecord в порядке BusId, вместе с готовыми сведениями о маршруте;
+//  остановки маршрутов - StopId всех маршрутов подряд, маршрут ссылается на свой отрезок;
+//  расстояния  - DistanceRecord по возрастанию пары остановок;
+//  настройки   - узел JSON с настройками отрисовки и маршрутизации в двоичном виде.
+//Контрольная сумма покрывает все байты после заголовка
+namespace catalogue_snapshot {
+inline constexpr char MAGIC[8] = {'T', 'C', 'C', 'A', 'T', 'L', 'G', '\0'};
+inline constexpr uint32_t FORMAT_VERSION = 2;
+
+struct Header {
+    char magic[8];
+    uint32_t version = FORMAT_VERSION;
+    uint32_t header_size = sizeof(Header);
+    uint64_t checksum = 0;
+    uint64_t file_size = 0;
+
+    routing_index::Section strings;
+    routing_index::Section stops;
+    routing_index::Section buses;
+    routing_index::Section bus_stops;
+    routing_index::Section distances;
+    routing_index::Section settings;
+};
+
+struct StopRecord {
+    uint64_t name_offset;
+    uint64_t name_size;
+    double lat;
+    double lng;
+};
+
+struct BusRecord {
+    uint64_t name_offset;
+    uint64_t name_size;
+    uint64_t first_stop;  //Индекс первой остановки в секции остановок маршрутов
+    uint64_t stop_count;
+    uint64_t is_roundtrip;
+    uint64_t unique_stops;
+    double route_length;
+    double geo_length;
+};
+
+struct DistanceRecord {
+    uint32_t stop_from;
+    uint32_t stop_to;
+    double distance;
+};
+
+//Записывает справочник и settings в файл снимка через временный файл
+void Save(const TransportCatalogue& catalogue, const json::Node& settings, const std::string& path);
+
+//Загружает снимок в пустой справочник, который сразу становится замороженным: записи
+//переносятся в массивы замороженного справочника без AddStop/AddBus и пересчета длин маршрутов.
+//false, если файла нет, он поврежден или другой версии, справочник при этом не меняется
+bool Load(const std::string& path, TransportCatalogue& catalogue, json::Node& settings);
+}  // namespace catalogue_snapshot
@@ -0,0 +1,711 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+//Движок на иерархии сжатий (contraction hierarchy).
+//При построении вершины сжимаются по очереди в порядке "важности", вместо каждой сжатой вершины
+//добавляются ребра-сокращения, помнящие пару ребер, которые они заменяют. Запрос - двунаправленный
+//Дейкстра только "вверх" по иерархии, найденный путь разворачивается в цепочку исходных ребер графа
+template <typename Weight>
+class ContractionHierarchyRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterEngine<Weight>::RouteInfo;
+
+    using typename RouterEngine<Weight>::WeightMatrix;
+
+    explicit ContractionHierarchyRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    //Один полный поиск вверх от from на все цели, для каждой цели - только обратный поиск от нее
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override;
+
+    //Многие-ко-многим на корзинах: по одному поиску вверх от каждой цели и от каждого источника
+    //вместо sources x targets двунаправленных поисков
+    WeightMatrix ComputeWeightMatrix(const std::vector<VertexId>& sources,
+                                     const std::vector<VertexId>& targets,
+                                     parallel::ThreadPool& thread_pool) const override;
+
+    size_t GetMemoryFootprint() const override;
+
+    size_t GetShortcutCount() const;
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    //Ограничения на число вершин, просматриваемых при поиске пути-свидетеля: при оценке приоритета
+    //и при самом сжатии. Если свидетель не найден, добавляется лишнее (но корректное) сокращение
+    static constexpr size_t ESTIMATE_SETTLE_LIMIT = 20;
+    static constexpr size_t CONTRACT_SETTLE_LIMIT = 200;
+
+    struct HierarchyEdge {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId original_edge = NO_EDGE;  //Ребро исходного графа, NO_EDGE для сокращения
+        EdgeId first_half = NO_EDGE;     //Ребра иерархии, которые заменяет сокращение
+        EdgeId second_half = NO_EDGE;
+    };
+
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    using MinQueue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    struct Shortcut {
+        EdgeId edge_in;
+        EdgeId edge_out;
+    };
+
+    //Состояние, нужное только на время построения иерархии
+    struct ContractionState {
+        std::vector<std::vector<EdgeId>> out_edges;
+        std::vector<std::vector<EdgeId>> in_edges;
+        std::vector<bool> contracted;
+        std::vector<int> contracted_neighbours;
+        std::vector<int> levels;
+
+        std::vector<std::optional<Weight>> witness_weights;
+        std::vector<VertexId> witness_touched;
+    };
+
+    void AddOriginalEdges(const Graph& graph);
+    void Contract();
+
+    std::vector<Shortcut> FindShortcuts(VertexId vertex, size_t settle_limit, ContractionState& state) const;
+    void RunWitnessSearch(VertexId source, VertexId ignored, Weight max_weight, size_t settle_limit,
+                          ContractionState& state) const;
+    int ComputePriority(VertexId vertex, ContractionState& state) const;
+    void ContractVertex(VertexId vertex, ContractionState& state);
+
+    void UnpackEdge(EdgeId edge_id, std::vector<const Edge<Weight>*>& edges) const;
+
+    //Ребра исходного графа на пути через meeting_vertex: по последним ребрам прямого поиска до нее
+    //и обратного поиска после нее
+    std::vector<const Edge<Weight>*> UnpackPath(VertexId meeting_vertex, const std::vector<EdgeId>& forward_prev_edges,
+                                                const std::vector<EdgeId>& backward_prev_edges) const;
+
+    //Полный поиск из start только вверх по иерархии: по upward_edges_ (forward) или по downward_edges_
+    //в обратную сторону. Возвращает извлеченные вершины с их весами
+    std::vector<QueueItem> SearchUpward(VertexId start, bool forward) const;
+
+    //Полный поиск из start вверх по upward_edges_ с весами и последними ребрами путей
+    void SearchUpwardTree(VertexId start, std::vector<std::optional<Weight>>& weights,
+                          std::vector<EdgeId>& prev_edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<HierarchyEdge> edges_;
+    std::vector<size_t> rank_;
+    std::vector<std::vector<EdgeId>> upward_edges_;    //По вершине from: ребра в вершины старшего ранга
+    std::vector<std::vector<EdgeId>> downward_edges_;  //По вершине to: ребра из вершин старшего ранга
+    size_t shortcut_count_ = 0;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph)
+    : graph_(graph)
+    , rank_(graph.GetVertexCount())
+    , upward_edges_(graph.GetVertexCount())
+    , downward_edges_(graph.GetVertexCount()) {
+    AddOriginalEdges(graph);
+    Contract();
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::AddOriginalEdges(const Graph& graph) {
+    std::vector<EdgeId> edge_ids;
+    edge_ids.reserve(graph.GetEdgeCount());
+
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+
+        //Петли никогда не лежат на кратчайшем пути
+        if (edge.from != edge.to) {
+            edge_ids.push_back(edge_id);
+        }
+    }
+
+    //Из параллельных ребер оставляем самое легкое, при равенстве - добавленное раньше
+    std::sort(edge_ids.begin(), edge_ids.end(), [&graph](EdgeId lhs, EdgeId rhs) {
+        const auto& lhs_edge = graph.GetEdge(lhs);
+        const auto& rhs_edge = graph.GetEdge(rhs);
+        return std::tie(lhs_edge.from, lhs_edge.to, lhs_edge.weight, lhs)
+             < std::tie(rhs_edge.from, rhs_edge.to, rhs_edge.weight, rhs);
+    });
+
+    for (const EdgeId edge_id : edge_ids) {
+        const auto& edge = graph.GetEdge(edge_id);
+
+        if (!edges_.empty() && edges_.back().from == edge.from && edges_.back().to == edge.to) {
+            continue;
+        }
+        edges_.push_back({edge.from, edge.to, edge.weight, edge_id});
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::Contract() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    ContractionState state;
+    state.out_edges.resize(vertex_count);
+    state.in_edges.resize(vertex_count);
+    state.contracted.assign(vertex_count, false);
+    state.contracted_neighbours.assign(vertex_count, 0);
+    state.levels.assign(vertex_count, 0);
+    state.witness_weights.resize(vertex_count);
+
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        state.out_edges[edges_[edge_id].from].push_back(edge_id);
+        state.in_edges[edges_[edge_id].to].push_back(edge_id);
+    }
+
+    //Очередь с ленивым обновлением: приоритет вершины пересчитывается при извлечении,
+    //и если он стал хуже следующего в очереди, вершина возвращается обратно
+    using PriorityItem = std::pair<int, VertexId>;
+    std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.push({ComputePriority(vertex, state), vertex});
+    }
+
+    size_t next_rank = 0;
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+
+        const int priority = ComputePriority(vertex, state);
+        if (!queue.empty() && priority > queue.top().first) {
+            queue.push({priority, vertex});
+            continue;
+        }
+
+        rank_[vertex] = next_rank++;
+        ContractVertex(vertex, state);
+    }
+
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const auto& edge = edges_[edge_id];
+
+        if (rank_[edge.from] < rank_[edge.to]) {
+            upward_edges_[edge.from].push_back(edge_id);
+        } else {
+            downward_edges_[edge.to].push_back(edge_id);
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::RunWitnessSearch(VertexId source, VertexId ignored, Weight max_weight,
+                                                          size_t settle_limit, ContractionState& state) const {
+    for (const VertexId vertex : state.witness_touched) {
+        state.witness_weights[vertex].reset();
+    }
+    state.witness_touched.clear();
+
+    MinQueue queue;
+    state.witness_weights[source] = ZERO_WEIGHT;
+    state.witness_touched.push_back(source);
+    queue.push({ZERO_WEIGHT, source});
+
+    size_t settled = 0;
+    while (!queue.empty() && settled < settle_limit) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        if (*state.witness_weights[vertex] < weight) {
+            continue;
+        }
+        if (max_weight < weight) {
+            break;
+        }
+        ++settled;
+
+        for (const EdgeId edge_id : state.out_edges[vertex]) {
+            const auto& edge = edges_[edge_id];
+            if (edge.to == ignored || state.contracted[edge.to]) {
+                continue;
+            }
+
+            const Weight candidate_weight = weight + edge.weight;
+            auto& to_weight = state.witness_weights[edge.to];
+
+            if (!to_weight || candidate_weight < *to_weight) {
+                if (!to_weight) {
+                    state.witness_touched.push_back(edge.to);
+                }
+                to_weight = candidate_weight;
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchyRouter<Weight>::Shortcut>
+ContractionHierarchyRouter<Weight>::FindShortcuts(VertexId vertex, size_t settle_limit,
+                                                  ContractionState& state) const {
+    std::vector<Shortcut> shortcuts;
+
+    std::optional<Weight> max_out_weight;
+    for (const EdgeId edge_out : state.out_edges[vertex]) {
+        const auto& edge = edges_[edge_out];
+        if (!state.contracted[edge.to] && (!max_out_weight || *max_out_weight < edge.weight)) {
+            max_out_weight = edge.weight;
+        }
+    }
+
+    if (!max_out_weight) {
+        return shortcuts;
+    }
+
+    for (const EdgeId edge_in : state.in_edges[vertex]) {
+        const VertexId source = edges_[edge_in].from;
+        if (state.contracted[source]) {
+            continue;
+        }
+
+        RunWitnessSearch(source, vertex, edges_[edge_in].weight + *max_out_weight, settle_limit, state);
+
+        for (const EdgeId edge_out : state.out_edges[vertex]) {
+            const VertexId target = edges_[edge_out].to;
+            if (state.contracted[target] || target == source) {
+                continue;
+            }
+
+            const Weight via_weight = edges_[edge_in].weight + edges_[edge_out].weight;
+            const auto& witness_weight = state.witness_weights[target];
+
+            if (!witness_weight || via_weight < *witness_weight) {
+                shortcuts.push_back({edge_in, edge_out});
+            }
+        }
+    }
+
+    return shortcuts;
+}
+
+template <typename Weight>
+int ContractionHierarchyRouter<Weight>::ComputePriority(VertexId vertex, ContractionState& state) const {
+    int removed_edges = 0;
+    for (const EdgeId edge_id : state.out_edges[vertex]) {
+        removed_edges += state.contracted[edges_[edge_id].to] ? 0 : 1;
+    }
+    for (const EdgeId edge_id : state.in_edges[vertex]) {
+        removed_edges += state.contracted[edges_[edge_id].from] ? 0 : 1;
+    }
+
+    const int added_edges = static_cast<int>(FindShortcuts(vertex, ESTIMATE_SETTLE_LIMIT, state).size());
+
+    return 2 * (added_edges - removed_edges) + state.contracted_neighbours[vertex] + state.levels[vertex];
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::ContractVertex(VertexId vertex, ContractionState& state) {
+    for (const auto [edge_in, edge_out] : FindShortcuts(vertex, CONTRACT_SETTLE_LIMIT, state)) {
+        const VertexId from = edges_[edge_in].from;
+        const VertexId to = edges_[edge_out].to;
+        const Weight weight = edges_[edge_in].weight + edges_[edge_out].weight;
+
+        //Не дублируем ребро, если между вершинами уже есть не более тяжелое
+        const auto& from_edges = state.out_edges[from];
+        if (std::any_of(from_edges.begin(), from_edges.end(), [this, to, weight](EdgeId edge_id) {
+                return edges_[edge_id].to == to && !(weight < edges_[edge_id].weight);
+            })) {
+            continue;
+        }
+
+        edges_.push_back({from, to, weight, NO_EDGE, edge_in, edge_out});
+        ++shortcut_count_;
+
+        state.out_edges[from].push_back(edges_.size() - 1);
+        state.in_edges[to].push_back(edges_.size() - 1);
+    }
+
+    state.contracted[vertex] = true;
+
+    //Ребра в сжатую вершину больше не нужны соседям при поиске свидетелей
+    auto erase_contracted = [this, &state](std::vector<EdgeId>& edge_ids, bool by_target) {
+        edge_ids.erase(std::remove_if(edge_ids.begin(), edge_ids.end(), [this, &state, by_target](EdgeId edge_id) {
+                           return state.contracted[by_target ? edges_[edge_id].to : edges_[edge_id].from];
+                       }),
+                       edge_ids.end());
+    };
+
+    for (const EdgeId edge_id : state.out_edges[vertex]) {
+        const VertexId neighbour = edges_[edge_id].to;
+        ++state.contracted_neighbours[neighbour];
+        state.levels[neighbour] = std::max(state.levels[neighbour], state.levels[vertex] + 1);
+        erase_contracted(state.in_edges[neighbour], /* by_target */ false);
+    }
+    for (const EdgeId edge_id : state.in_edges[vertex]) {
+        const VertexId neighbour = edges_[edge_id].from;
+        ++state.contracted_neighbours[neighbour];
+        state.levels[neighbour] = std::max(state.levels[neighbour], state.levels[vertex] + 1);
+        erase_contracted(state.out_edges[neighbour], /* by_target */ true);
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    //Индекс 0 - прямой поиск от from, индекс 1 - обратный поиск от to
+    std::vector<std::optional<Weight>> weights[2] = {std::vector<std::optional<Weight>>(vertex_count),
+                                                     std::vector<std::optional<Weight>>(vertex_count)};
+    std::vector<EdgeId> prev_edges[2] = {std::vector<EdgeId>(vertex_count, NO_EDGE),
+                                         std::vector<EdgeId>(vertex_count, NO_EDGE)};
+    MinQueue queues[2];
+
+    weights[0][from] = ZERO_WEIGHT;
+    weights[1][to] = ZERO_WEIGHT;
+    queues[0].push({ZERO_WEIGHT, from});
+    queues[1].push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+
+    auto is_active = [&best_weight, &queues](size_t direction) {
+        return !queues[direction].empty()
+               && (!best_weight || queues[direction].top().weight < *best_weight);
+    };
+
+    for (size_t direction = 0; is_active(0) || is_active(1); direction ^= 1) {
+        if (!is_active(direction)) {
+            continue;
+        }
+
+        const auto [weight, vertex] = queues[direction].top();
+        queues[direction].pop();
+
+        if (*weights[direction][vertex] < weight) {
+            continue;
+        }
+
+        if (const auto& opposite_weight = weights[direction ^ 1][vertex]) {
+            const Weight candidate_weight = weight + *opposite_weight;
+            if (!best_weight || candidate_weight < *best_weight) {
+                best_weight = candidate_weight;
+                meeting_vertex = vertex;
+            }
+        }
+
+        const auto& edge_ids = direction == 0 ? upward_edges_[vertex] : downward_edges_[vertex];
+        for (const EdgeId edge_id : edge_ids) {
+            const auto& edge = edges_[edge_id];
+            const VertexId next_vertex = direction == 0 ? edge.to : edge.from;
+            const Weight candidate_weight = weight + edge.weight;
+            auto& next_weight = weights[direction][next_vertex];
+
+            if (!next_weight || candidate_weight < *next_weight) {
+                next_weight = candidate_weight;
+                prev_edges[direction][next_vertex] = edge_id;
+                queues[direction].push({candidate_weight, next_vertex});
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    return RouteInfo{*best_weight, UnpackPath(meeting_vertex, prev_edges[0], prev_edges[1])};
+}
+
+template <typename Weight>
+std::vector<std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>>
+ContractionHierarchyRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<RouteInfo>> routes;
+    routes.reserve(targets.size());
+
+    //Для одной цели двунаправленный поиск останавливается раньше полного поиска вверх
+    if (targets.size() == 1) {
+        routes.push_back(BuildRoute(from, targets.front()));
+        return routes;
+    }
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || std::any_of(targets.begin(), targets.end(), [vertex_count](VertexId to) {
+            return to >= vertex_count;
+        })) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    std::vector<std::optional<Weight>> forward_weights;
+    std::vector<EdgeId> forward_prev_edges;
+    SearchUpwardTree(from, forward_weights, forward_prev_edges);
+
+    std::vector<std::optional<Weight>> backward_weights(vertex_count);
+    std::vector<EdgeId> backward_prev_edges(vertex_count, NO_EDGE);
+    std::vector<VertexId> touched;
+
+    for (const VertexId to : targets) {
+        for (const VertexId vertex : touched) {
+            backward_weights[vertex].reset();
+            backward_prev_edges[vertex] = NO_EDGE;
+        }
+        touched.clear();
+
+        //Прямой поиск полный, поэтому обратный можно остановить, как только его вес
+        //не меньше лучшего найденного маршрута
+        MinQueue queue;
+        backward_weights[to] = ZERO_WEIGHT;
+        touched.push_back(to);
+        queue.push({ZERO_WEIGHT, to});
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = to;
+
+        while (!queue.empty() && (!best_weight || queue.top().weight < *best_weight)) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+
+            if (*backward_weights[vertex] < weight) {
+                continue;
+            }
+
+            if (const auto& forward_weight = forward_weights[vertex]) {
+                const Weight candidate_weight = *forward_weight + weight;
+                if (!best_weight || candidate_weight < *best_weight) {
+                    best_weight = candidate_weight;
+                    meeting_vertex = vertex;
+                }
+            }
+
+            for (const EdgeId edge_id : downward_edges_[vertex]) {
+                const auto& edge = edges_[edge_id];
+                const Weight candidate_weight = weight + edge.weight;
+                auto& next_weight = backward_weights[edge.from];
+
+                if (!next_weight || candidate_weight < *next_weight) {
+                    if (!next_weight) {
+                        touched.push_back(edge.from);
+                    }
+                    next_weight = candidate_weight;
+                    backward_prev_edges[edge.from] = edge_id;
+                    queue.push({candidate_weight, edge.from});
+                }
+            }
+        }
+
+        if (!best_weight) {
+            routes.push_back(std::nullopt);
+            continue;
+        }
+
+        routes.push_back(RouteInfo{*best_weight, UnpackPath(meeting_vertex, forward_prev_edges, backward_prev_edges)});
+    }
+
+    return routes;
+}
+
+template <typename Weight>
+std::vector<const Edge<Weight>*> ContractionHierarchyRouter<Weight>::UnpackPath(
+    VertexId meeting_vertex, const std::vector<EdgeId>& forward_prev_edges,
+    const std::vector<EdgeId>& backward_prev_edges) const {
+    std::vector<EdgeId> forward_path;
+    for (VertexId vertex = meeting_vertex; forward_prev_edges[vertex] != NO_EDGE;
+         vertex = edges_[forward_prev_edges[vertex]].from) {
+        forward_path.push_back(forward_prev_edges[vertex]);
+    }
+    std::reverse(forward_path.begin(), forward_path.end());
+
+    for (VertexId vertex = meeting_vertex; backward_prev_edges[vertex] != NO_EDGE;
+         vertex = edges_[backward_prev_edges[vertex]].to) {
+        forward_path.push_back(backward_prev_edges[vertex]);
+    }
+
+    std::vector<const Edge<Weight>*> edges;
+    for (const EdgeId edge_id : forward_path) {
+        UnpackEdge(edge_id, edges);
+    }
+
+    return edges;
+}
+
+template <typename Weight>
+typename ContractionHierarchyRouter<Weight>::WeightMatrix
+ContractionHierarchyRouter<Weight>::ComputeWeightMatrix(const std::vector<VertexId>& sources,
+                                                        const std::vector<VertexId>& targets,
+                                                        parallel::ThreadPool& thread_pool) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    auto is_out_of_graph = [vertex_count](VertexId vertex) {
+        return vertex >= vertex_count;
+    };
+    if (std::any_of(sources.begin(), sources.end(), is_out_of_graph)
+        || std::any_of(targets.begin(), targets.end(), is_out_of_graph)) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    std::vector<std::vector<QueueItem>> backward_spaces(targets.size());
+    thread_pool.ParallelFor(targets.size(), [this, &backward_spaces, &targets](size_t j) {
+        backward_spaces[j] = SearchUpward(targets[j], false);
+    });
+
+    //Корзина вершины: номера целей, чей обратный поиск ее достиг, и вес пути от вершины до цели.
+    //Заполняется в порядке целей, чтобы результат не зависел от числа потоков
+    struct BucketItem {
+        size_t target_index;
+        Weight weight;
+    };
+    std::vector<std::vector<BucketItem>> buckets(vertex_count);
+    for (size_t j = 0; j < targets.size(); ++j) {
+        for (const auto& [weight, vertex] : backward_spaces[j]) {
+            buckets[vertex].push_back({j, weight});
+        }
+    }
+    backward_spaces.clear();
+
+    WeightMatrix matrix(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+    thread_pool.ParallelFor(sources.size(), [this, &matrix, &buckets, &sources](size_t i) {
+        auto& row = matrix[i];
+
+        for (const auto& [weight, vertex] : SearchUpward(sources[i], true)) {
+            for (const auto& [target_index, bucket_weight] : buckets[vertex]) {
+                const Weight candidate_weight = weight + bucket_weight;
+                if (!row[target_index] || candidate_weight < *row[target_index]) {
+                    row[target_index] = candidate_weight;
+                }
+            }
+        }
+    });
+
+    return matrix;
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchyRouter<Weight>::QueueItem>
+ContractionHierarchyRouter<Weight>::SearchUpward(VertexId start, bool forward) const {
+    std::vector<std::optional<Weight>> weights(graph_.GetVertexCount());
+    std::vector<QueueItem> settled;
+    MinQueue queue;
+
+    weights[start] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, start});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        if (*weights[vertex] < weight) {
+            continue;
+        }
+        settled.push_back({weight, vertex});
+
+        for (const EdgeId edge_id : forward ? upward_edges_[vertex] : downward_edges_[vertex]) {
+            const auto& edge = edges_[edge_id];
+            const VertexId next_vertex = forward ? edge.to : edge.from;
+            const Weight candidate_weight = weight + edge.weight;
+            auto& next_weight = weights[next_vertex];
+
+            if (!next_weight || candidate_weight < *next_weight) {
+                next_weight = candidate_weight;
+                queue.push({candidate_weight, next_vertex});
+            }
+        }
+    }
+
+    return settled;
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::SearchUpwardTree(VertexId start, std::vector<std::optional<Weight>>& weights,
+                                                          std::vector<EdgeId>& prev_edges) const {
+    weights.assign(graph_.GetVertexCount(), std::nullopt);
+    prev_edges.assign(graph_.GetVertexCount(), NO_EDGE);
+    MinQueue queue;
+
+    weights[start] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, start});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        if (*weights[vertex] < weight) {
+            continue;
+        }
+
+        for (const EdgeId edge_id : upward_edges_[vertex]) {
+            const auto& edge = edges_[edge_id];
+            const Weight candidate_weight = weight + edge.weight;
+            auto& next_weight = weights[edge.to];
+
+            if (!next_weight || candidate_weight < *next_weight) {
+                next_weight = candidate_weight;
+                prev_edges[edge.to] = edge_id;
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::UnpackEdge(EdgeId edge_id, std::vector<const Edge<Weight>*>& edges) const {
+    std::vector<EdgeId> stack{edge_id};
+
+    while (!stack.empty()) {
+        const auto& edge = edges_[stack.back()];
+        stack.pop_back();
+
+        if (edge.original_edge != NO_EDGE) {
+            edges.push_back(&graph_.GetEdge(edge.original_edge));
+            continue;
+        }
+
+        //Вторая половина кладется первой, чтобы первая развернулась раньше
+        stack.push_back(edge.second_half);
+        stack.push_back(edge.first_half);
+    }
+}
+
+template <typename Weight>
+size_t ContractionHierarchyRouter<Weight>::GetShortcutCount() const {
+    return shortcut_count_;
+}
+
+template <typename Weight>
+size_t ContractionHierarchyRouter<Weight>::GetMemoryFootprint() const {
+    size_t footprint = edges_.capacity() * sizeof(HierarchyEdge) + rank_.capacity() * sizeof(size_t);
+
+    for (const auto* adjacency : {&upward_edges_, &downward_edges_}) {
+        footprint += adjacency->capacity() * sizeof(std::vector<EdgeId>);
+        for (const auto& edge_ids : *adjacency) {
+            footprint += edge_ids.capacity() * sizeof(EdgeId);
+        }
+    }
+
+    return footprint;
+}
+}  // namespace graph
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+//Дерево кратчайших путей из from по алгоритму Дейкстры на двоичной куче. Растет, пока не извлечены
+//все targets или не кончился граф. Веса и последние ребра путей пишутся в weights и prev_edges
+template <typename Weight>
+void GrowShortestPathTree(const DirectedWeightedGraph<Weight>& graph, VertexId from,
+                          const std::vector<VertexId>& targets, std::vector<std::optional<Weight>>& weights,
+                          std::vector<std::optional<EdgeId>>& prev_edges) {
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    constexpr Weight ZERO_WEIGHT{};
+    const size_t vertex_count = graph.GetVertexCount();
+    if (from >= vertex_count || std::any_of(targets.begin(), targets.end(), [vertex_count](VertexId to) {
+            return to >= vertex_count;
+        })) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    weights.assign(vertex_count, std::nullopt);
+    prev_edges.assign(vertex_count, std::nullopt);
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    //Сколько раз вершина встречается среди целей: поиск заканчивается, когда все цели извлечены
+    std::vector<size_t> target_counts(vertex_count);
+    for (const VertexId to : targets) {
+        ++target_counts[to];
+    }
+    size_t targets_left = targets.size();
+
+    weights[from] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, from});
+
+    while (!queue.empty() && targets_left > 0) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        //Устаревшая запись: вершина уже достигнута более коротким путем
+        if (*weights[vertex] < weight) {
+            continue;
+        }
+
+        targets_left -= target_counts[vertex];
+        if (targets_left == 0) {
+            break;
+        }
+
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            const VertexId target = edge.to;
+            const Weight candidate_weight = weight + edge.weight;
+
+            if (!weights[target] || candidate_weight < *weights[target]) {
+                weights[target] = candidate_weight;
+                prev_edges[target] = edge_id;
+                queue.push({candidate_weight, target});
+            }
+        }
+    }
+}
+
+//Ребра маршрута до to по последним ребрам путей дерева, от начала маршрута к концу
+template <typename Weight>
+std::vector<const Edge<Weight>*> CollectRouteEdges(const DirectedWeightedGraph<Weight>& graph,
+                                                   const std::vector<std::optional<EdgeId>>& prev_edges,
+                                                   VertexId to) {
+    std::vector<const Edge<Weight>*> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges[to];
+         edge_id;
+         edge_id = prev_edges[graph.GetEdge(*edge_id).from]) {
+
+        edges.push_back(&graph.GetEdge(*edge_id));
+    }
+
+    std::reverse(edges.begin(), edges.end());
+    return edges;
+}
+
+//Маршруты из from в каждую из targets по одному дереву кратчайших путей, в порядке targets
+template <typename Weight>
+std::vector<std::optional<typename RouterEngine<Weight>::RouteInfo>> BuildRoutesFromTree(
+    const DirectedWeightedGraph<Weight>& graph, VertexId from, const std::vector<VertexId>& targets) {
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+
+    std::vector<std::optional<Weight>> weights;
+    std::vector<std::optional<EdgeId>> prev_edges;
+    GrowShortestPathTree(graph, from, targets, weights, prev_edges);
+
+    std::vector<std::optional<RouteInfo>> routes;
+    routes.reserve(targets.size());
+
+    for (const VertexId to : targets) {
+        if (!weights[to]) {
+            routes.push_back(std::nullopt);
+            continue;
+        }
+
+        routes.push_back(RouteInfo{*weights[to], CollectRouteEdges(graph, prev_edges, to)});
+    }
+
+    return routes;
+}
+
+//Веса маршрутов из from в каждую из targets по одному дереву кратчайших путей, в порядке targets
+template <typename Weight>
+std::vector<std::optional<Weight>> ComputeTreeWeights(const DirectedWeightedGraph<Weight>& graph, VertexId from,
+                                                      const std::vector<VertexId>& targets) {
+    std::vector<std::optional<Weight>> weights;
+    std::vector<std::optional<EdgeId>> prev_edges;
+    GrowShortestPathTree(graph, from, targets, weights, prev_edges);
+
+    std::vector<std::optional<Weight>> target_weights;
+    target_weights.reserve(targets.size());
+
+    for (const VertexId to : targets) {
+        target_weights.push_back(weights[to]);
+    }
+
+    return target_weights;
+}
+
+//Движок без предрасчета: каждый запрос отвечается алгоритмом Дейкстры на двоичной куче.
+//Построение O(E), память O(V + E), запрос O((V + E) log V).
+//Обход читает концы и веса из самих ребер графа. Граф может быть и не заморожен,
+//но после заморозки смежные ребра всех вершин лежат в одном массиве и обходятся быстрее
+template <typename Weight>
+class DijkstraRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterEngine<Weight>::RouteInfo;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    //Одно дерево кратчайших путей из from, растущее до тех пор, пока не достигнуты все цели
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override;
+
+    size_t GetMemoryFootprint() const override;
+
+protected:
+    std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from,
+                                                           const std::vector<VertexId>& targets) const override;
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph) {
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    return std::move(BuildRoutes(from, {to}).front());
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>>
+DijkstraRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    return BuildRoutesFromTree(graph_, from, targets);
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> DijkstraRouter<Weight>::ComputeRouteWeights(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    return ComputeTreeWeights(graph_, from, targets);
+}
+
+template <typename Weight>
+size_t DijkstraRouter<Weight>::GetMemoryFootprint() const {
+    //Движок ничего не хранит между запросами
+    return 0;
+}
+}  // namespace graph
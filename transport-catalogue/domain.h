@@ -1,23 +1,35 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "geo.h"
+#include "ranges.h"
 
 namespace domain {
+//Плотные номера остановок и маршрутов в справочнике: 0, 1, 2... в порядке добавления
+using StopId = uint32_t;
+using BusId = uint32_t;
+
 struct Stop;
 
+//Остановки маршрута по порядку. Сами указатели хранит справочник
+using StopsRange = ranges::Range<const Stop* const*>;
+
 struct Bus {
 	std::string name_bus;
-    std::vector<const Stop*> stops_for_bus;
+    StopsRange stops_for_bus;
     bool is_roundtrip;
+    BusId id = 0;  //Назначается справочником
 };
 
 struct Stop {
     std::string name_stop;
     geo::Coordinates coordinates;
+    StopId id = 0;  //Назначается справочником
+    geo::PreparedCoordinates prepared_coordinates;  //Назначается справочником по coordinates
 
     bool operator==(const Stop& other) const {
         return name_stop == other.name_stop
@@ -25,6 +37,13 @@ struct Stop {
     }
 };
 
+//Расстояние по дорогам от одной остановки до другой, как оно задано в справочнике
+struct RoadDistance {
+    StopId stop_from;
+    StopId stop_to;
+    double distance;
+};
+
 struct RouteDistanceInfo {
     double route_length;
     double route_curvature;
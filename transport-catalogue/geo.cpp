@@ -5,15 +5,61 @@
 #include "geo.h"
 
 namespace geo {
+static const double DR = M_PI / 180.0;
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
-    const double dr = M_PI / 180.0;
-    return acos(sin(from.lat * dr) * sin(to.lat * dr)
-                + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-        * 6371000;
+    return acos(sin(from.lat * DR) * sin(to.lat * DR)
+                + cos(from.lat * DR) * cos(to.lat * DR) * cos(abs(from.lng - to.lng) * DR))
+        * EARTH_RADIUS;
+}
+
+PreparedCoordinates PrepareCoordinates(Coordinates coordinates) {
+    return PreparedCoordinates{std::sin(coordinates.lat * DR), std::cos(coordinates.lat * DR), coordinates.lng};
+}
+
+//Порядок операций тот же, что в ComputeDistance(Coordinates, Coordinates): у коротких перегонов
+//аргумент acos близок к 1, и отличие в последнем бите дало бы заметную относительную погрешность
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to) {
+    using namespace std;
+    return acos(from.sin_lat * to.sin_lat
+                + from.cos_lat * to.cos_lat * cos(abs(from.lng - to.lng) * DR))
+        * EARTH_RADIUS;
+}
+
+double ComputePolylineLength(const std::vector<PreparedCoordinates>& points) {
+    if(points.size() < 2) {
+        return 0.;
+    }
+
+    //Сначала аргументы acos для всех перегонов, затем acos и сумма по порядку. Умножения и
+    //сложения первого прохода без зависимостей между итерациями и векторизуются компилятором
+    std::vector<double> cos_angles(points.size() - 1);
+    for(size_t i = 0; i + 1 < points.size(); ++i) {
+        cos_angles[i] = std::cos(std::abs(points[i].lng - points[i + 1].lng) * DR);
+    }
+    for(size_t i = 0; i + 1 < points.size(); ++i) {
+        cos_angles[i] = points[i].sin_lat * points[i + 1].sin_lat
+                        + points[i].cos_lat * points[i + 1].cos_lat * cos_angles[i];
+    }
+
+    double length = 0.;
+    for(const double cos_angle : cos_angles) {
+        length += std::acos(cos_angle) * EARTH_RADIUS;
+    }
+    return length;
+}
+
+void ToUnitVector(Coordinates point, double (&result)[3]) {
+    const double lat = point.lat * DR;
+    const double lng = point.lng * DR;
+
+    result[0] = std::cos(lat) * std::cos(lng);
+    result[1] = std::cos(lat) * std::sin(lng);
+    result[2] = std::sin(lat);
 }
 
 bool Coordinates::operator==(const Coordinates other) const {
     return lat == other.lat && lng == other.lng;
 }
-} // namespace geo
\ No newline at end of file
+} // namespace geo
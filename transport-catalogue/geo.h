@@ -1,6 +1,10 @@
 #pragma once
 
+#include <vector>
+
 namespace geo {
+inline constexpr double EARTH_RADIUS = 6371000;  //В метрах
+
 struct Coordinates {
     double lat; // Широта
     double lng; // Долгота
@@ -8,5 +12,22 @@ struct Coordinates {
     bool operator== (const Coordinates other) const;
 };
 
+//Координаты с заранее посчитанными sin и cos широты. Расстояние между такими точками
+//обходится без sin и cos широт и совпадает с ComputeDistance по исходным координатам бит в бит
+struct PreparedCoordinates {
+    double sin_lat = 0.;
+    double cos_lat = 1.;
+    double lng = 0.;  //В градусах, как в Coordinates
+};
+
 double ComputeDistance(Coordinates from, Coordinates to);
-}  // namespace geo
\ No newline at end of file
+
+PreparedCoordinates PrepareCoordinates(Coordinates coordinates);
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to);
+
+//Длина ломаной: сумма расстояний между соседними точками, по порядку
+double ComputePolylineLength(const std::vector<PreparedCoordinates>& points);
+
+//Точка на единичной сфере: x и y в плоскости экватора (x - к нулевому меридиану), z - к северному полюсу
+void ToUnitVector(Coordinates point, double (&result)[3]);
+}  // namespace geo
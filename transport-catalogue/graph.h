@@ -1,19 +1,28 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
+#include <deque>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "ranges.h"
 
 namespace graph {
-using VertexId = size_t;
-using EdgeId = size_t;
+//32-битные id: вершин и ребер в графе меньше 2^32, а ребро и смежность становятся вдвое компактнее
+using VertexId = uint32_t;
+using EdgeId = uint32_t;
+using NameId = uint32_t;
 
 template <typename Weight>
 struct Edge {
-    std::string name = "";
-    size_t span_count = 0;
+    //id имени в таблице строк графа (DirectedWeightedGraph::AddName/GetName): одна копия имени
+    //на все ребра маршрута
+    NameId name = 0;
+    uint32_t span_count = 0;
     VertexId from = 0;
     VertexId to = 0;
     Weight weight{};  
@@ -25,12 +34,13 @@ public:
     BuildEdge() : edge_() {
     }
 
-    BuildEdge& SetName(std::string name) {
+    //id из DirectedWeightedGraph::AddName того графа, в который добавляется ребро
+    BuildEdge& SetName(NameId name) {
         edge_.name = name;
         return *this;
     }
 
-    BuildEdge& SetSpanCount(size_t span_count) {
+    BuildEdge& SetSpanCount(uint32_t span_count) {
         edge_.span_count = span_count;
         return *this;
     }
@@ -58,6 +68,11 @@ private:
     Edge<Weight> edge_;
 };
 
+//Граф строится через AddEdge, затем Freeze переводит списки смежности в формат CSR:
+//id исходящих ребер всех вершин лежат подряд в одном массиве, вершина задается смещением.
+//Концы и веса ребер хранятся только в самих ребрах, без отдельных массивов CSR: копии занимали
+//больше половины памяти графа, а обход Дейкстрой и A* с ними не ускорялся заметно.
+//Имена ребер хранятся один раз в таблице строк графа и получают 32-битные id
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
@@ -67,34 +82,152 @@ private:
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
+
+    //Ключи поиска имен ссылаются на таблицу строк графа, копия ссылалась бы на чужую
+    DirectedWeightedGraph(const DirectedWeightedGraph&) = delete;
+    DirectedWeightedGraph& operator=(const DirectedWeightedGraph&) = delete;
+    DirectedWeightedGraph(DirectedWeightedGraph&&) = default;
+    DirectedWeightedGraph& operator=(DirectedWeightedGraph&&) = default;
+
+    //Имя ребра должно быть уже добавлено через AddName
     EdgeId AddEdge(const Edge<Weight>& edge);
 
+    //Заменяет ребра [first, last) на edges, id следующих ребер сдвигаются. Смежность перестраивается
+    //целиком и получается такой же, как при построении графа заново. Работает и после заморозки
+    void ReplaceEdges(EdgeId first, EdgeId last, const std::vector<Edge<Weight>>& edges);
+
+    //После заморозки AddEdge недоступен, id ребер и порядок обхода смежных ребер не меняются
+    void Freeze();
+    bool IsFrozen() const;
+
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+    //Добавляет имя в таблицу строк, если его там нет, и возвращает его id
+    NameId AddName(std::string_view name);
+    size_t GetNameCount() const;
+    NameId GetNameId(std::string_view name) const;
+    std::string_view GetName(NameId name_id) const;
+
+    //Память в байтах, занятая ребрами, смежностью и таблицей строк
+    size_t GetMemoryFootprint() const;
+
 private:
+    void CheckEdge(const Edge<Weight>& edge) const;
+
+    //Смежные ребра каждой вершины - по возрастанию id, как после последовательных AddEdge
+    void RebuildIncidence();
+
+    size_t vertex_count_ = 0;
     std::vector<Edge<Weight>> edges_;
-    std::vector<IncidenceList> incidence_lists_;
+    std::vector<IncidenceList> incidence_lists_;  //До заморозки
+
+    std::vector<EdgeId> incidence_offsets_;  //После заморозки: V + 1 смещений в incident_edges_
+    IncidenceList incident_edges_;
+    bool is_frozen_ = false;
+
+    //deque не перемещает строки при добавлении, ключи name_ids_ остаются верными
+    std::deque<std::string> names_;
+    std::unordered_map<std::string_view, NameId> name_ids_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count) {
+    if (vertex_count > UINT32_MAX) {
+        throw std::length_error("Too many vertices for 32-bit ids");
+    }
+    incidence_lists_.resize(vertex_count);
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (is_frozen_) {
+        throw std::logic_error("Can't add edge to frozen graph");
+    }
+
+    CheckEdge(edge);
+    if (edges_.size() >= UINT32_MAX) {
+        throw std::length_error("Too many edges for 32-bit ids");
+    }
+    auto& incidence_list = incidence_lists_[edge.from];
     edges_.push_back(edge);
+
     const EdgeId id = edges_.size() - 1;
-    incidence_lists_.at(edge.from).push_back(id);
+    incidence_list.push_back(id);
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::ReplaceEdges(EdgeId first, EdgeId last, const std::vector<Edge<Weight>>& edges) {
+    if (first > last || last > edges_.size()) {
+        throw std::out_of_range("Edge range is out of graph");
+    }
+
+    for (const auto& edge : edges) {
+        CheckEdge(edge);
+    }
+    if (edges_.size() - (last - first) + edges.size() > UINT32_MAX) {
+        throw std::length_error("Too many edges for 32-bit ids");
+    }
+
+    edges_.erase(edges_.begin() + first, edges_.begin() + last);
+    edges_.insert(edges_.begin() + first, edges.begin(), edges.end());
+
+    RebuildIncidence();
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (is_frozen_) {
+        return;
+    }
+
+    is_frozen_ = true;
+    RebuildIncidence();
+
+    std::vector<IncidenceList>().swap(incidence_lists_);
+    edges_.shrink_to_fit();
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::RebuildIncidence() {
+    if (!is_frozen_) {
+        for (auto& incidence_list : incidence_lists_) {
+            incidence_list.clear();
+        }
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            incidence_lists_[edges_[edge_id].from].push_back(edge_id);
+        }
+        return;
+    }
+
+    //Сортировка подсчетом по вершине from, устойчивая по id ребра
+    incidence_offsets_.assign(vertex_count_ + 1, 0);
+    for (const auto& edge : edges_) {
+        ++incidence_offsets_[edge.from + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        incidence_offsets_[vertex + 1] += incidence_offsets_[vertex];
+    }
+
+    incident_edges_.resize(edges_.size());
+    std::vector<EdgeId> positions(incidence_offsets_.begin(), incidence_offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        incident_edges_[positions[edges_[edge_id].from]++] = edge_id;
+    }
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return is_frozen_;
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -110,6 +243,74 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    if (!is_frozen_) {
+        return ranges::AsRange(incidence_lists_.at(vertex));
+    }
+
+    if (vertex >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+    return {incident_edges_.begin() + incidence_offsets_[vertex],
+            incident_edges_.begin() + incidence_offsets_[vertex + 1]};
+}
+
+template <typename Weight>
+NameId DirectedWeightedGraph<Weight>::AddName(std::string_view name) {
+    if (const auto iter = name_ids_.find(name); iter != name_ids_.end()) {
+        return iter->second;
+    }
+
+    if (names_.size() == UINT32_MAX) {
+        throw std::length_error("Too many edge names");
+    }
+
+    const std::string& added = names_.emplace_back(name);
+    const auto name_id = static_cast<NameId>(names_.size() - 1);
+    name_ids_.emplace(added, name_id);
+    return name_id;
+}
+
+template <typename Weight>
+size_t DirectedWeightedGraph<Weight>::GetNameCount() const {
+    return names_.size();
+}
+
+template <typename Weight>
+NameId DirectedWeightedGraph<Weight>::GetNameId(std::string_view name) const {
+    return name_ids_.at(name);
+}
+
+template <typename Weight>
+std::string_view DirectedWeightedGraph<Weight>::GetName(NameId name_id) const {
+    return names_.at(name_id);
+}
+
+template <typename Weight>
+size_t DirectedWeightedGraph<Weight>::GetMemoryFootprint() const {
+    size_t footprint = edges_.capacity() * sizeof(Edge<Weight>)
+                       + incidence_lists_.capacity() * sizeof(IncidenceList)
+                       + incidence_offsets_.capacity() * sizeof(EdgeId)
+                       + incident_edges_.capacity() * sizeof(EdgeId)
+                       + names_.size() * sizeof(std::string)
+                       + name_ids_.size() * (sizeof(std::string_view) + sizeof(NameId));
+
+    for (const auto& incidence_list : incidence_lists_) {
+        footprint += incidence_list.capacity() * sizeof(EdgeId);
+    }
+    for (const auto& name : names_) {
+        footprint += name.capacity();
+    }
+
+    return footprint;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::CheckEdge(const Edge<Weight>& edge) const {
+    if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+    if (edge.name >= names_.size()) {
+        throw std::out_of_range("Edge name is not in graph");
+    }
 }
 }  // namespace graph
\ No newline at end of file
@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
 #include <iterator>
+#include <optional>
+#include <string_view>
 
 #include "json.h"
 
@@ -7,235 +13,424 @@ namespace json {
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+//Пары [first, entries.end()) упорядочиваются и переносятся в словарь одним блоком, entries
+//укорачивается до first. Повтор ключа обнаруживается здесь, уже после разбора всего словаря
+Dict MakeDict(std::vector<Dict::value_type>& entries, size_t first, std::pmr::memory_resource* resource) {
+    const auto begin = entries.begin() + first;
+    std::sort(begin, entries.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    const auto duplicate = std::adjacent_find(begin, entries.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first;
+    });
+    if (duplicate != entries.end()) {
+        throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+    }
 
-std::string LoadLiteral(std::istream& input) {
-    std::string s;
+    Dict dict(Dict::sorted_unique, std::make_move_iterator(begin), std::make_move_iterator(entries.end()), resource);
+    entries.erase(begin, entries.end());
+    return dict;
+}
 
-    while (std::isalpha(input.peek())) {
-        s.push_back(static_cast<char>(input.get()));
+//Разбор непрерывного буфера. Строка без escape-последовательностей не копируется посимвольно:
+//ReadString возвращает string_view прямо в буфер, а число читается std::from_chars прямо из буфера.
+//Поток разбирается так же, через буфер, который подкачивается из streambuf кусками по ходу разбора
+class BufferParser {
+public:
+    BufferParser(std::string_view input, std::pmr::memory_resource* resource)
+        : pos_(input.data())
+        , end_(input.data() + input.size())
+        , resource_(resource) {
     }
 
-    return s;
-}
+    BufferParser(std::streambuf& source, std::pmr::memory_resource* resource)
+        : pos_(nullptr)
+        , end_(nullptr)
+        , resource_(resource)
+        , source_(&source)
+        , chunk_(CHUNK_SIZE) {
+    }
 
-Node LoadArray(std::istream& input) {
-    std::vector<Node> result;
+    Node LoadNode() {
+        switch (const char c = ReadToken()) {
+            case '[':
+                return LoadArray();
+            case '{':
+                return LoadDict();
+            case '"':
+                return Node(String(ReadString(), resource_));
+            default:
+                return LoadScalar(c);
+        }
+    }
 
-    for (char c; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
+    void ParseNode(Handler& handler) {
+        switch (const char c = ReadToken()) {
+            case '[':
+                ParseArray(handler);
+                break;
+            case '{':
+                ParseDict(handler);
+                break;
+            case '"':
+                handler.String(ReadString());
+                break;
+            default:
+                handler.Value(LoadScalar(c));
+                break;
         }
-        result.push_back(LoadNode(input));
     }
 
-    if (!input) {
-        throw ParsingError("Array parsing error"s);
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+    //Есть ли еще символ. В конце куска потока подкачивает следующий
+    bool HasChar() {
+        return pos_ != end_ || Refill();
     }
 
-    return Node(std::move(result));
-}
+    //Читает следующий кусок потока. Недочитанная лексема с token_ переносится в начало буфера,
+    //поэтому указатели на нее остаются действительными через token_
+    bool Refill() {
+        if (!source_) {
+            return false;
+        }
+
+        const size_t kept = token_ ? static_cast<size_t>(end_ - token_) : 0;
+        if (kept > 0) {
+            std::memmove(chunk_.data(), token_, kept);
+        }
+        if (chunk_.size() - kept < CHUNK_SIZE / 2) {
+            chunk_.resize(chunk_.size() * 2);
+        }
+
+        const std::streamsize read = source_->sgetn(chunk_.data() + kept, static_cast<std::streamsize>(chunk_.size() - kept));
+        if (token_) {
+            token_ = chunk_.data();
+        }
+        pos_ = chunk_.data() + kept;
+        end_ = pos_ + std::max<std::streamsize>(read, 0);
+        return read > 0;
+    }
 
-Node LoadDict(std::istream& input) {
-    Dict dict;
+    //Как input >> c: пропускает пробельные символы и читает следующий. false в конце входа
+    bool ReadChar(char& c) {
+        while (HasChar() && IsSpace(*pos_)) {
+            ++pos_;
+        }
 
-    for (char c; input >> c && c != '}';) {
-        if (c == '"') {
-            std::string key = LoadString(input).AsString();
+        if (pos_ == end_) {
+            return false;
+        }
 
-            if (input >> c && c == ':') {
+        c = *pos_++;
+        return true;
+    }
 
-                if (dict.find(key) != dict.end()) {
-                    throw ParsingError("Duplicate key '"s + key + "' have been found");
-                }
-                dict.emplace(std::move(key), LoadNode(input));
+    char ReadToken() {
+        char c;
+        if (!ReadChar(c)) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        return c;
+    }
+
+    //Те же символы, что пропускает operator>> в локали "C"
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    bool IsDigit() {
+        return HasChar() && std::isdigit(static_cast<unsigned char>(*pos_));
+    }
+
+    //Литерал, число или ошибка. Первый символ c уже прочитан
+    Node LoadScalar(char c) {
+        --pos_;
+
+        if (c == 't' || c == 'f') {
+            const std::string_view literal = LoadLiteral();
+            if (literal == "true"sv) {
+                return Node{true};
+            } else if (literal == "false"sv) {
+                return Node{false};
+            }
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as bool"s);
+        }
+
+        if (c == 'n') {
+            if (const std::string_view literal = LoadLiteral(); literal == "null"sv) {
+                return Node{nullptr};
             } else {
-                throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
             }
-        } else if (c != ',') {
-            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
         }
+
+        return LoadNumber();
     }
 
-    if (!input) {
-        throw ParsingError("Dictionary parsing error"s);
+    std::string_view LoadLiteral() {
+        token_ = pos_;
+        while (HasChar() && std::isalpha(static_cast<unsigned char>(*pos_))) {
+            ++pos_;
+        }
+        return ReleaseToken();
     }
 
-    return Node(std::move(dict));
-}
+    std::string_view ReleaseToken() {
+        const std::string_view token(token_, static_cast<size_t>(pos_ - token_));
+        token_ = nullptr;
+        return token;
+    }
+
+    Node LoadArray() {
+        //Элементы копятся в общем стеке и переносятся в арену одним блоком точного размера:
+        //при росте массива прямо в арене каждый старый буфер оставался бы в ней мусором
+        const size_t first_item = items_.size();
+
+        bool is_closed = false;
+        for (char c; ReadChar(c);) {
+            if (c == ']') {
+                is_closed = true;
+                break;
+            }
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
-    while (true) {
-        if (it == end) {
-            throw ParsingError("String parsing error");
+            if (c != ',') {
+                --pos_;
+            }
+            Node item = LoadNode();
+            items_.push_back(std::move(item));
         }
-        const char ch = *it;
 
-        if (ch == '"') {
-            ++it;
-            break;
-        } else if (ch == '\\') {
-            ++it;
+        if (!is_closed) {
+            throw ParsingError("Array parsing error"s);
+        }
 
-            if (it == end) {
-                throw ParsingError("String parsing error");
+        Array result(resource_);
+        result.reserve(items_.size() - first_item);
+        std::move(items_.begin() + first_item, items_.end(), std::back_inserter(result));
+        items_.resize(first_item);
+
+        return Node(std::move(result));
+    }
+
+    void ParseArray(Handler& handler) {
+        handler.StartArray();
+
+        bool is_closed = false;
+        for (char c; ReadChar(c);) {
+            if (c == ']') {
+                is_closed = true;
+                break;
             }
-            const char escaped_char = *(it);
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+
+            if (c != ',') {
+                --pos_;
             }
-        } else if (ch == '\n' || ch == '\r') {
-            throw ParsingError("Unexpected end of line"s);
-        } else {
-            s.push_back(ch);
+            ParseNode(handler);
         }
-        ++it;
+
+        if (!is_closed) {
+            throw ParsingError("Array parsing error"s);
+        }
+
+        handler.EndArray();
     }
 
-    return Node(std::move(s));
-}
+    Node LoadDict() {
+        //Пары копятся в общем стеке, как элементы массивов
+        const size_t first_entry = entries_.size();
 
-Node LoadBool(std::istream& input) {
-    const auto s = LoadLiteral(input);
-    if (s == "true"sv) {
-        return Node{true};
-    } else if (s == "false"sv) {
-        return Node{false};
-    } else {
-        throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+        while (true) {
+            const std::optional<std::string_view> key = LoadKey();
+            if (!key) {
+                break;
+            }
+
+            //Ключ копируется до разбора значения: тот перепишет буферы, на которые указывает key
+            String key_string(*key, resource_);
+            Node value = LoadNode();
+            entries_.emplace_back(std::move(key_string), std::move(value));
+        }
+
+        return Node(MakeDict(entries_, first_entry, resource_));
     }
-}
 
-Node LoadNull(std::istream& input) {
-    if (auto literal = LoadLiteral(input); literal == "null"sv) {
-        return Node{nullptr};
-    } else {
-        throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+    void ParseDict(Handler& handler) {
+        handler.StartDict();
+
+        while (true) {
+            const std::optional<std::string_view> key = LoadKey();
+            if (!key) {
+                break;
+            }
+
+            handler.Key(*key);
+            ParseNode(handler);
+        }
+
+        handler.EndDict();
     }
-}
 
-Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
+    //Следующий ключ словаря вместе с двоеточием, nullopt на закрывающей скобке.
+    //Ключ действителен до следующего чтения строки
+    std::optional<std::string_view> LoadKey() {
+        for (char c; ReadChar(c);) {
+            if (c == '}') {
+                return std::nullopt;
+            }
+
+            if (c == '"') {
+                std::string_view key = ReadString();
+                //Подкачка потока в поисках двоеточия сдвинула бы ключ, лежащий в куске потока
+                if (source_ && key.data() != buffer_.data()) {
+                    buffer_.assign(key);
+                    key = buffer_;
+                }
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
+                if (ReadChar(c) && c == ':') {
+                    return key;
+                }
+                throw ParsingError(": is expected but '"s + c + "' has been found"s);
+            }
 
-        if (!input) {
-            throw ParsingError("Failed to read number from stream"s);
+            if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
         }
-    };
 
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw ParsingError("A digit is expected"s);
+        throw ParsingError("Dictionary parsing error"s);
+    }
+
+    //Строка после открывающей кавычки. Без escape-последовательностей - кусок самого буфера,
+    //иначе раскодированная копия в buffer_. Обе живут до следующего чтения строки
+    std::string_view ReadString() {
+        token_ = pos_;
+        while (HasChar() && *pos_ != '"' && *pos_ != '\\' && *pos_ != '\n' && *pos_ != '\r') {
+            ++pos_;
         }
 
-        while (std::isdigit(input.peek())) {
-            read_char();
+        if (pos_ != end_ && *pos_ == '"') {
+            const std::string_view s = ReleaseToken();
+            ++pos_;
+            return s;
         }
-    };
 
-    if (input.peek() == '-') {
-        read_char();
+        std::string& s = buffer_;
+        s.assign(ReleaseToken());
+        while (true) {
+            if (!HasChar()) {
+                throw ParsingError("String parsing error");
+            }
+            const char ch = *pos_++;
+
+            if (ch == '"') {
+                break;
+            } else if (ch == '\\') {
+                if (!HasChar()) {
+                    throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *pos_++;
+                switch (escaped_char) {
+                    case 'n':
+                        s.push_back('\n');
+                        break;
+                    case 't':
+                        s.push_back('\t');
+                        break;
+                    case 'r':
+                        s.push_back('\r');
+                        break;
+                    case '"':
+                        s.push_back('"');
+                        break;
+                    case '\\':
+                        s.push_back('\\');
+                        break;
+                    default:
+                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+            } else if (ch == '\n' || ch == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            } else {
+                s.push_back(ch);
+            }
+        }
+
+        return s;
     }
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
+
+    Node LoadNumber() {
+        token_ = pos_;
+
+        auto read_digits = [this] {
+            if (!IsDigit()) {
+                throw ParsingError("A digit is expected"s);
+            }
+
+            while (IsDigit()) {
+                ++pos_;
+            }
+        };
+
+        if (HasChar() && *pos_ == '-') {
+            ++pos_;
+        }
         // После 0 в JSON не могут идти другие цифры
-    } else {
-        read_digits();
-    }
+        if (HasChar() && *pos_ == '0') {
+            ++pos_;
+        } else {
+            read_digits();
+        }
 
-    bool is_int = true;
-    // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
-        read_digits();
-        is_int = false;
-    }
+        bool is_int = true;
+        if (HasChar() && *pos_ == '.') {
+            ++pos_;
+            read_digits();
+            is_int = false;
+        }
 
-    // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
+        if (HasChar() && (*pos_ == 'e' || *pos_ == 'E')) {
+            ++pos_;
 
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+            if (HasChar() && (*pos_ == '+' || *pos_ == '-')) {
+                ++pos_;
+            }
+            read_digits();
+            is_int = false;
         }
-        read_digits();
-        is_int = false;
-    }
 
-    try {
+        const std::string_view number = ReleaseToken();
+        const char* begin = number.data();
+        const char* end = begin + number.size();
+
         if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении
-                // код ниже попробует преобразовать строку в double
+            int value = 0;
+            //При переполнении int число читается как double
+            if (const auto [last, error] = std::from_chars(begin, end, value); error == std::errc{}) {
+                return value;
             }
         }
 
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+        double value = 0.;
+        if (const auto [last, error] = std::from_chars(begin, end, value); error != std::errc{}) {
+            throw ParsingError("Failed to convert "s + std::string(number) + " to number"s);
+        }
+        return value;
     }
-}
 
-Node LoadNode(std::istream& input) {
-    char c;
-    if (!(input >> c)) {
-        throw ParsingError("Unexpected EOF"s);
-    }
+    const char* pos_;
+    const char* end_;
+    std::pmr::memory_resource* resource_;  //Память словарей, массивов и строк
+    std::vector<Node> items_;              //Элементы недоразобранных массивов
+    std::vector<Dict::value_type> entries_;  //Пары недоразобранных словарей
+    std::string buffer_;                     //Последняя строка с escape-последовательностями
 
-    switch (c) {
-        case '[':
-            return LoadArray(input);
-        case '{':
-            return LoadDict(input);
-        case '"':
-            return LoadString(input);
-        case 't':
-            // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-            // подсказкой компилятору и человеку, что здесь программист явно задумывал
-            // разрешить переход к инструкции следующей ветки case, а не случайно забыл
-            // написать break, return или throw.
-            // В данном случае, встретив t или f, переходим к попытке парсинга
-            // литералов true либо false
-            [[fallthrough]];
-        case 'f':
-            input.putback(c);
-            return LoadBool(input);
-        case 'n':
-            input.putback(c);
-            return LoadNull(input);
-        default:
-            input.putback(c);
-            return LoadNumber(input);
-    }
-}
+    std::streambuf* source_ = nullptr;  //Поток, из которого подкачивается chunk_
+    std::vector<char> chunk_;
+    const char* token_ = nullptr;       //Начало лексемы, которая читается сейчас
+};
 
 struct PrintContext {
     std::ostream& out;
@@ -260,7 +455,7 @@ void PrintValue(const Value& value, const PrintContext& ctx) {
     ctx.out << value;
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
+void PrintString(std::string_view value, std::ostream& out) {
     out.put('"');
 
     for (const char c : value) {
@@ -290,7 +485,7 @@ void PrintString(const std::string& value, std::ostream& out) {
 }
 
 template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
+void PrintValue<String>(const String& value, const PrintContext& ctx) {
     PrintString(value, ctx.out);
 }
 
@@ -362,10 +557,77 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
 }
 }  // namespace
 
+//______Dict______
+Dict::Dict(std::pmr::memory_resource* resource) : entries_(resource) {
+}
+
+Dict::iterator Dict::begin() {
+    return entries_.begin();
+}
+
+Dict::iterator Dict::end() {
+    return entries_.end();
+}
+
+Dict::const_iterator Dict::begin() const {
+    return entries_.begin();
+}
+
+Dict::const_iterator Dict::end() const {
+    return entries_.end();
+}
+
+size_t Dict::size() const {
+    return entries_.size();
+}
+
+bool Dict::empty() const {
+    return entries_.empty();
+}
+
+Dict::iterator Dict::find(std::string_view key) {
+    const auto iter = LowerBound(key);
+    return iter != entries_.end() && iter->first == key ? iter : entries_.end();
+}
+
+Dict::const_iterator Dict::find(std::string_view key) const {
+    return const_cast<Dict*>(this)->find(key);
+}
+
+std::pair<Dict::iterator, bool> Dict::emplace(std::string_view key, Node value) {
+    const auto iter = LowerBound(key);
+    if (iter != entries_.end() && iter->first == key) {
+        return {iter, false};
+    }
+    return {entries_.emplace(iter, key, std::move(value)), true};
+}
+
+Node& Dict::operator[](std::string_view key) {
+    return emplace(key, Node(nullptr)).first->second;
+}
+
+bool Dict::operator==(const Dict& rhs) const {
+    return entries_ == rhs.entries_;
+}
+
+Dict::iterator Dict::LowerBound(std::string_view key) {
+    //Пары чаще всего добавляются по возрастанию ключа: тогда место - в конце, без поиска
+    if (entries_.empty() || entries_.back().first < key) {
+        return entries_.end();
+    }
+
+    return std::lower_bound(entries_.begin(), entries_.end(), key, [](const value_type& entry, std::string_view key) {
+        return entry.first < key;
+    });
+}
+
 //______Node______
 Node::Node(Value value) : variant(std::move(value)) {
 }
 
+Node::Node(std::string value) : variant(String(value)) {
+}
+
 bool Node::IsInt() const {
     return std::holds_alternative<int>(*this);
 }
@@ -431,17 +693,17 @@ const Array& Node::AsArray() const {
 }
 
 bool Node::IsString() const {
-    return std::holds_alternative<std::string>(*this);
+    return std::holds_alternative<String>(*this);
 }
 
-const std::string& Node::AsString() const {
+std::string_view Node::AsString() const {
     using namespace std::literals;
 
     if (!IsString()) {
         throw std::logic_error("Not a string"s);
     }
 
-    return std::get<std::string>(*this);
+    return std::get<String>(*this);
 }
 
 bool Node::IsDict() const {
@@ -478,6 +740,28 @@ bool operator!=(const Node& lhs, const Node& rhs) {
 Document::Document(Node root) : root_(std::move(root)) {
 }
 
+Document::Document(Node root, std::shared_ptr<std::pmr::monotonic_buffer_resource> arena)
+    : arena_(std::move(arena))
+    , root_(std::move(root)) {
+}
+
+Document::Document(const Document& other) : root_(other.root_) {
+}
+
+Document& Document::operator=(const Document& rhs) {
+    return *this = Document(rhs);
+}
+
+Document& Document::operator=(Document&& rhs) {
+    if (this != &rhs) {
+        //Присваивание узлу с тем же типом писало бы новое дерево в старую арену
+        root_ = Node(nullptr);
+        root_ = std::move(rhs.root_);
+        arena_ = std::move(rhs.arena_);
+    }
+    return *this;
+}
+
 const Node &Document::GetRoot() const {
     return root_;
 }
@@ -492,11 +776,33 @@ bool operator!=(const Document& lhs, const Document& rhs) {
 
 //_____Other______
 Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>();
+    BufferParser parser(*input.rdbuf(), arena.get());
+    return Document{parser.LoadNode(), std::move(arena)};
+}
+
+Document Load(std::string_view input) {
+    //Первый блок арены - по размеру входа: узлы дерева обычно занимают не меньше
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(input.size(), 1));
+    BufferParser parser(input, arena.get());
+    //Аргументы в фигурных скобках вычисляются слева направо: арена передается уже после разбора
+    return Document{parser.LoadNode(), std::move(arena)};
+}
+
+void Parse(std::istream& input, Handler& handler) {
+    BufferParser(*input.rdbuf(), std::pmr::get_default_resource()).ParseNode(handler);
+}
+
+void Parse(std::string_view input, Handler& handler) {
+    BufferParser(input, std::pmr::get_default_resource()).ParseNode(handler);
 }
 
 void Print(const Document& doc, std::ostream& output) {
     PrintNode(doc.GetRoot(), PrintContext{output});
 }
 
+void Print(const Node& node, std::ostream& output, int indent) {
+    PrintNode(node, PrintContext{output, 4, indent});
+}
+
 } // namespace json
\ No newline at end of file
@@ -1,16 +1,73 @@
 #pragma once
 
 #include <iostream>
-#include <map>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+//Словари, массивы и строки берут память из memory_resource. По умолчанию это обычная куча, а
+//разобранное дерево лежит в арене своего Document. Копия узла всегда уходит в кучу и от
+//арены не зависит, перемещение сохраняет арену источника
+using Array = std::pmr::vector<Node>;
+using String = std::pmr::string;
+
+//Словарь - вектор пар, упорядоченный по ключу: обход идет подряд по памяти и в том же порядке,
+//что у std::map, поиск двоичный. Вставка сдвигает хвост вектора, поэтому разбор собирает
+//пары целиком, сортирует и передает в конструктор с sorted_unique
+class Dict {
+public:
+    using value_type = std::pair<String, Node>;
+
+private:
+    using Storage = std::pmr::vector<value_type>;
+
+public:
+    using iterator = Storage::iterator;
+    using const_iterator = Storage::const_iterator;
+
+    //Пары уже упорядочены по ключу и ключи не повторяются
+    struct SortedUnique {
+    };
+    static constexpr SortedUnique sorted_unique{};
+
+    Dict() = default;
+    explicit Dict(std::pmr::memory_resource* resource);
+
+    template <typename Iterator>
+    Dict(SortedUnique, Iterator first, Iterator last,
+         std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+
+    //Как у std::map: если ключ уже есть, словарь не меняется и возвращается false.
+    //Новый ключ копируется в память словаря
+    std::pair<iterator, bool> emplace(std::string_view key, Node value);
+    Node& operator[](std::string_view key);
+
+    bool operator==(const Dict& rhs) const;
+
+private:
+    iterator LowerBound(std::string_view key);
+
+    Storage entries_;
+};
 
 class ParsingError : public std::runtime_error {
 public:
@@ -18,12 +75,13 @@ public:
 };
 
 class Node final
-    : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+    : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, String> {
 public:
     using variant::variant;
 	using Value = variant;
     
     Node(Value value);
+    Node(std::string value);
 
     bool IsInt() const;
     int AsInt() const;
@@ -41,7 +99,7 @@ public:
     const Array& AsArray() const;
 
     bool IsString() const;
-    const std::string& AsString() const;
+    std::string_view AsString() const;
 
     bool IsDict() const;
     const Dict& AsDict() const;
@@ -54,20 +112,68 @@ public:
 
 inline bool operator!=(const Node& lhs, const Node& rhs);
 
+template <typename Iterator>
+Dict::Dict(SortedUnique, Iterator first, Iterator last, std::pmr::memory_resource* resource)
+    : entries_(resource) {
+    entries_.reserve(static_cast<size_t>(std::distance(first, last)));
+    entries_.insert(entries_.end(), first, last);
+}
+
 class Document {
 public:
     explicit Document(Node root);
+    //root лежит в arena: она освобождается разом вместе с последней копией документа
+    Document(Node root, std::shared_ptr<std::pmr::monotonic_buffer_resource> arena);
+
+    //Копия дерева уходит в кучу. При присваивании старое дерево уничтожается раньше своей арены
+    Document(const Document& other);
+    Document(Document&& other) = default;
+    Document& operator=(const Document& rhs);
+    Document& operator=(Document&& rhs);
 
     const Node& GetRoot() const;
 private:
+    std::shared_ptr<std::pmr::monotonic_buffer_resource> arena_;  //Объявлена раньше дерева и переживает его
     Node root_;
 };
 
 inline bool operator==(const Document& lhs, const Document& rhs);
 inline bool operator!=(const Document& lhs, const Document& rhs);
 
+//Поток читается кусками через его streambuf, поэтому из него может быть прочитано больше,
+//чем занимает сам документ
 Document Load(std::istream& input);
 
+//Разбор непрерывного буфера - файла, прочитанного целиком или отображенного в память.
+//Строки без escape-последовательностей копируются из буфера одним куском, числа читаются
+//std::from_chars, словари и массивы выделяются в арене документа, а не отдельными вызовами new
+Document Load(std::string_view input);
+
+//Обработчик потокового разбора: Parse сообщает о каждом элементе по мере чтения, не строя дерево.
+//null, bool и числа приходят в Value, строки - в String. Ключи и строки передаются как string_view
+//во входной буфер или во внутренний буфер разбора и действительны только до возврата из вызова.
+//Повторы ключей проверяет сам обработчик
+class Handler {
+public:
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+
+    virtual void Value(Node value) = 0;
+    virtual void String(std::string_view value) = 0;
+
+protected:
+    ~Handler() = default;
+};
+
+void Parse(std::istream& input, Handler& handler);
+void Parse(std::string_view input, Handler& handler);
+
 void Print(const Document& doc, std::ostream& output);
+//Печатает узел так же, как если бы он был вложен в документ с отступом indent пробелов
+void Print(const Node& node, std::ostream& output, int indent);
 
 }  // namespace json
\ No newline at end of file
@@ -1,46 +1,54 @@
 #include "json_builder.h"
 
+#include <iterator>
+
 using namespace std::literals;
 
 namespace json {
 //--------------------BUILDER----------------------
 Builder::DictItemContext Builder::StartDict() {
-    AddObject(Dict{}, /* one_shot */ false);
+    AddObject(Dict(scratch_ ? scratch_ : resource_), /* one_shot */ false);
     return BaseContext{*this};
 }
 
 Builder::ArrayItemContext Builder::StartArray() {
-    AddObject(Array{}, /* one_shot */ false);
+    AddObject(Array(scratch_ ? scratch_ : resource_), /* one_shot */ false);
     return BaseContext{*this};
 }
 
-Builder::DictValueContext Builder::Key(const std::string key) {
+Builder::DictValueContext Builder::Key(std::string_view key) {
     Node::Value& host_value = GetCurrentValue();
     
     nodes_stack_.push_back(
-        &std::get<Dict>(host_value)[std::move(key)]
+        &std::get<Dict>(host_value)[key]
     );
 
     return BaseContext{*this};
 }
 
-Builder::BaseContext Builder::Value(Node::Value value) {
-    AddObject(std::move(value), /* one_shot */ true);
+bool Builder::HasKey(std::string_view key) const {
+    const Dict* dict = std::get_if<Dict>(&GetCurrentValue());
+    return dict && dict->find(key) != dict->end();
+}
+
+Builder::BaseContext Builder::Value(Node value) {
+    AddObject(std::move(value.GetValue()), /* one_shot */ true);
     return *this;
 }
 
 Builder::BaseContext Builder::EndDict() {
-    nodes_stack_.pop_back();
+    EndObject();
     return *this;
 }
 
 Builder::BaseContext Builder::EndArray() {
-    nodes_stack_.pop_back();
+    EndObject();
     return *this;
 }
 
 Node Builder::Build() {
-    return root_;
+    //Перемещение, а не копия: копия ушла бы из resource_ в кучу
+    return std::move(root_);
 }
 
 Node::Value& Builder::GetCurrentValue() {
@@ -81,16 +89,37 @@ void Builder::AddObject(Node::Value value, bool one_shot) {
     }
 }
 
+void Builder::EndObject() {
+    Node::Value& host_value = GetCurrentValue();
+
+    //Перемещающее присваивание контейнеру из scratch оставило бы данные в scratch,
+    //поэтому старый контейнер сначала уничтожается
+    if (Array* array = std::get_if<Array>(&host_value); scratch_ && array) {
+        Array moved(resource_);
+        moved.reserve(array->size());
+        std::move(array->begin(), array->end(), std::back_inserter(moved));
+        host_value = nullptr;
+        host_value = std::move(moved);
+    } else if (Dict* dict = std::get_if<Dict>(&host_value); scratch_ && dict) {
+        Dict moved(Dict::sorted_unique, std::make_move_iterator(dict->begin()),
+                   std::make_move_iterator(dict->end()), resource_);
+        host_value = nullptr;
+        host_value = std::move(moved);
+    }
+
+    nodes_stack_.pop_back();
+}
+
 //--------------------DICTVALUECONTEXT----------------------
 
-Builder::DictItemContext Builder::DictValueContext::Value(Node::Value value) {
-    Builder::BaseContext::Value(value);
+Builder::DictItemContext Builder::DictValueContext::Value(Node value) {
+    Builder::BaseContext::Value(std::move(value));
     return BaseContext {*this};
 }
 
 //--------------------ARRAYITEMCONTEXT----------------------
-Builder::ArrayItemContext Builder::ArrayItemContext::Value(Node::Value value) {
-    Builder::BaseContext::Value(value);
+Builder::ArrayItemContext Builder::ArrayItemContext::Value(Node value) {
+    Builder::BaseContext::Value(std::move(value));
     return BaseContext {*this};
 }
 } // namespace json
@@ -2,7 +2,9 @@
 
 #include <iostream>
 #include <map>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -15,17 +17,27 @@ class Builder {
     class DictValueContext;
     class ArrayItemContext;
 public:
-    Builder() : root_(),
-                nodes_stack_ {&root_} {
+    //Словари, массивы и ключи нового дерева берут память из resource. Значения Builder
+    //переносит как есть, поэтому строки для той же памяти создает вызывающий.
+    //С scratch открытый словарь или массив растет в scratch и при закрытии переносится в resource
+    //одним блоком точного размера: иначе каждый старый буфер контейнера оставался бы мусором в арене
+    explicit Builder(std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                     std::pmr::memory_resource* scratch = nullptr)
+                : root_(),
+                nodes_stack_ {&root_},
+                resource_(resource),
+                scratch_(scratch) {
 
     }
 
     DictItemContext StartDict();
     ArrayItemContext StartArray();
 
-    DictValueContext Key(const std::string key);
+    DictValueContext Key(std::string_view key);
+    //Есть ли key в открытом словаре: по нему обработчик событий разбора находит повтор ключа
+    bool HasKey(std::string_view key) const;
 
-    BaseContext Value(Node::Value value);
+    BaseContext Value(Node value);
     BaseContext EndDict();
     BaseContext EndArray();
 
@@ -33,12 +45,16 @@ public:
 private:
     json::Node root_;
     std::vector<json::Node*> nodes_stack_;
+    std::pmr::memory_resource* resource_;
+    std::pmr::memory_resource* scratch_;
 
     Node::Value& GetCurrentValue();
     const Node::Value& GetCurrentValue() const;
 
     void AssertNewObjectContext() const;
     void AddObject(Node::Value value, bool one_shot);
+    //Закрывает словарь или массив на вершине стека
+    void EndObject();
 
     class BaseContext{
     public:
@@ -53,12 +69,12 @@ private:
             return builder_.StartArray();
         }
 
-        DictValueContext Key(const std::string& key) {
+        DictValueContext Key(std::string_view key) {
             return builder_.Key(key);
         }
 
-        BaseContext Value(Node::Value value) {
-            return builder_.Value(value);
+        BaseContext Value(Node value) {
+            return builder_.Value(std::move(value));
         }
         BaseContext EndDict() {
             return builder_.EndDict();
@@ -81,7 +97,7 @@ private:
 
         DictItemContext StartDict() = delete;
         ArrayItemContext StartArray() = delete;
-        BaseContext Value(Node::Value value) = delete;
+        BaseContext Value(Node value) = delete;
         BaseContext EndArray() = delete;
 
         Node Build() = delete;
@@ -92,7 +108,7 @@ private:
         DictValueContext(BaseContext base) : BaseContext(base) {
         }
 
-        DictItemContext Value(Node::Value value);
+        DictItemContext Value(Node value);
 
         DictValueContext Key() = delete;
         BaseContext EndDict() = delete;
@@ -106,9 +122,9 @@ private:
         ArrayItemContext(BaseContext base) : BaseContext(base) {
         }
 
-        ArrayItemContext Value(Node::Value value);
+        ArrayItemContext Value(Node value);
 
-        DictValueContext Key(const std::string& key) = delete;
+        DictValueContext Key(std::string_view key) = delete;
         BaseContext EndDict() = delete;
 
         Node Build() = delete;
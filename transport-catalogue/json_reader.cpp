@@ -1,12 +1,20 @@
 #include "json_reader.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+
 using namespace graph;
 using namespace std::literals;
 using namespace json;
 
+using domain::Stop;
+using domain::StopId;
+
 using std::cerr;
 using std::optional;
-using std::set;
 using std::string;
 using std::string_view;
 using std::vector;
@@ -46,23 +54,24 @@ void JSONReader::ApplyArrayOfColorCharacteristics(const string& key, const Node&
 }
 
 void JSONReader::ApplyCommandToStop(const Node& node) {
+    Stop stop;
     std::string key_err;
     try {
         for(const auto& [key, value] : node.AsDict()){
             key_err = key;
-            if(key == "type"s && value.AsString() != "Stop"s) {
+            if(key == "type"sv && value.AsString() != "Stop"s) {
                 return;
             }
 
-            if(key == "name"s) {
+            if(key == "name"sv) {
                 stop.name_stop = value.AsString();
             }
 
-            if(key == "latitude"s) {
+            if(key == "latitude"sv) {
                 stop.coordinates.lat = value.AsDouble();
             }
 
-            if(key == "longitude"s) {
+            if(key == "longitude"sv) {
                 stop.coordinates.lng = value.AsDouble();
             }          
         } 
@@ -87,15 +96,15 @@ void JSONReader::ApplyCommandToDistance(const Node& node) {
             key_err = key;
 
             //Если не остановка выходим из функции
-            if(key == "type"s && value.AsString() != "Stop"s) {
+            if(key == "type"sv && value.AsString() != "Stop"s) {
                 return;
             }
 
-            if(key == "name"s) {
+            if(key == "name"sv) {
                 stop_from = value.AsString();
             }
 
-            if(key == "road_distances"s) {
+            if(key == "road_distances"sv) {
                 for(const auto& [stop_to, distance] : value.AsDict()) {
                     catalogue_->AddDistance(stop_from, stop_to, distance.AsDouble());
                 }
@@ -122,21 +131,21 @@ void JSONReader::ApplyCommandToBus(const json::Node& node) {
             key_err = key;
 
             //Если не маршрут выходим из функции
-            if(key == "type"s && value.AsString() != "Bus"s) {
+            if(key == "type"sv && value.AsString() != "Bus"s) {
                 return;
             }
 
-            if(key == "name"s) {
+            if(key == "name"sv) {
                 name_bus = value.AsString();
             }
 
-            if(key == "stops"s) {
+            if(key == "stops"sv) {
                 for(const auto& _stop : value.AsArray()) {
                     buffer_of_stops.push_back(_stop.AsString());
                 }
             }
 
-            if(key == "is_roundtrip"s) {
+            if(key == "is_roundtrip"sv) {
                 is_roundtrip = value.AsBool();
             }
         }
@@ -155,31 +164,34 @@ void JSONReader::ApplyCommandToBus(const json::Node& node) {
     }
 }
 
-void JSONReader::ApplyCommandToBusInfo(const int id_request, const string &name_bus, Builder &JSON_builder) const {
+void JSONReader::ApplyCommandToBusInfo(const int id_request, const string &name_bus, Writer& JSON_builder) const {
     using namespace domain;
 
     optional<BusInfo> bus_info = request_handler->GetBusInfo(name_bus);
 
-    JSON_builder.StartDict().Key("request_id"s).Value(id_request);
-
+    //Writer печатает ключи в порядке вызовов и требует, чтобы они шли по алфавиту, как в json::Print
     if(bus_info == std::nullopt) {
-        JSON_builder.Key("error_message"s).Value("not found"s); 
+        JSON_builder.StartDict()
+                    .Key("error_message"s).Value("not found"s)
+                    .Key("request_id"s).Value(id_request);
     } else {
-        JSON_builder.Key("stop_count"s).Value(bus_info.value().stops_on_route)
-                    .Key("unique_stop_count"s).Value(bus_info.value().unique_stops)
+        JSON_builder.StartDict()
+                    .Key("curvature"s).Value(bus_info.value().route_info.route_curvature)
+                    .Key("request_id"s).Value(id_request)
                     .Key("route_length"s).Value(bus_info.value().route_info.route_length)
-                    .Key("curvature"s).Value(bus_info.value().route_info.route_curvature);
+                    .Key("stop_count"s).Value(bus_info.value().stops_on_route)
+                    .Key("unique_stop_count"s).Value(bus_info.value().unique_stops);
     }
 
     JSON_builder.EndDict();
 }
 
-void JSONReader::ApplyCommandToStopInfo(const int id_request, const std::string& name_stop, Builder& JSON_builder) const {
+void JSONReader::ApplyCommandToStopInfo(const int id_request, const std::string& name_stop, Writer& JSON_builder) const {
     using namespace domain;
 
-    optional<set<string_view>> stop_info = request_handler->GetStopInfo(name_stop);
+    const auto stop_info = request_handler->GetStopInfo(name_stop);
 
-    JSON_builder.StartDict().Key("request_id"s).Value(id_request);
+    JSON_builder.StartDict();
 
     if(stop_info == std::nullopt) {
         JSON_builder.Key("error_message"s).Value("not found"s);
@@ -192,69 +204,150 @@ void JSONReader::ApplyCommandToStopInfo(const int id_request, const std::string&
         JSON_builder.EndArray();
     }
 
-    JSON_builder.EndDict();
+    JSON_builder.Key("request_id"s).Value(id_request)
+                .EndDict();
 }
 
-void JSONReader::ApplyCommandToMapInfo(const int id_request, Builder& JSON_builder) const {
+void JSONReader::ApplyCommandToMapInfo(const int id_request, Writer& JSON_builder) const {
     using namespace domain;
 
-    JSON_builder.StartDict().Key("request_id"s).Value(id_request);
-
     std::ostringstream strm;
     request_handler->RenderMap().Render(strm);
-    JSON_builder.Key("map"s).Value(strm.str())
+    JSON_builder.StartDict()
+                .Key("map"s).Value(strm.str())
+                .Key("request_id"s).Value(id_request)
                 .EndDict();
 }
 
 void JSONReader::ApplyCommandToRouteInfo(const int id_request, 
-                                         const string& stop_from, 
-                                         const string& stop_to, 
-                                         Builder& JSON_builder) const {
-    JSON_builder.StartDict().Key("request_id"s).Value(id_request);
-
-    const auto route = router_->BuildOptimazedRoute(stop_from, stop_to);
+                                         const optional<RouterEngine<double>::RouteInfo>& route,
+                                         Writer& JSON_builder) const {
+    JSON_builder.StartDict();
 
     if(!route) {
-        JSON_builder.Key("error_message"s).Value("not found"s);
+        JSON_builder.Key("error_message"s).Value("not found"s)
+                    .Key("request_id"s).Value(id_request);
     } else {
         JSON_builder.Key("items"s).StartArray();
 
-        for(const auto& edge : route->edges) {
+        const auto& edges = route->edges;
+
+        for(size_t i = 0; i < edges.size(); ++i) {
+            const auto& edge = edges[i];
             JSON_builder.StartDict();
 
             if(edge->span_count == 0) {
-                JSON_builder.Key("stop_name"s).Value(edge->name)
+                JSON_builder.Key("stop_name"s).Value(string(router_->GetEdgeName(*edge)))
                             .Key("time"s).Value(edge->weight)
                             .Key("type"s).Value("Wait"s);
             } else {
-                JSON_builder.Key("bus"s).Value(edge->name)
-                            .Key("span_count"s).Value(static_cast<int>(edge->span_count))
-                            .Key("time"s).Value(edge->weight)
+                //RAPTOR отдает поездку по перегонам: идущие подряд ребра того же автобуса - одна поездка
+                size_t span_count = edge->span_count;
+                double time = edge->weight;
+                for(; i + 1 < edges.size() && edges[i + 1]->span_count != 0
+                      && edges[i + 1]->name == edge->name; ++i) {
+                    span_count += edges[i + 1]->span_count;
+                    time += edges[i + 1]->weight;
+                }
+
+                JSON_builder.Key("bus"s).Value(string(router_->GetEdgeName(*edge)))
+                            .Key("span_count"s).Value(static_cast<int>(span_count))
+                            .Key("time"s).Value(time)
                             .Key("type"s).Value("Bus"s);
             }
             JSON_builder.EndDict();
             
         } 
         JSON_builder.EndArray();
-        JSON_builder.Key("total_time"s).Value(route->weight);
+        JSON_builder.Key("request_id"s).Value(id_request)
+                    .Key("total_time"s).Value(route->weight);
     }
     JSON_builder.EndDict();
 }   
 
+void JSONReader::ApplyCommandToMatrixInfo(const int id_request, const vector<string>& sources,
+                                          const vector<string>& targets, Writer& JSON_builder) const {
+
+    //Имена переводятся в id один раз, дальше движок работает только с id
+    auto to_stop_ids = [this](const vector<string>& names_stops) -> optional<vector<StopId>> {
+        vector<StopId> stop_ids;
+        stop_ids.reserve(names_stops.size());
+
+        for(const auto& name_stop : names_stops) {
+            const Stop* stop = catalogue_->FindStop(name_stop);
+            if(!stop) {
+                return std::nullopt;
+            }
+            stop_ids.push_back(stop->id);
+        }
+        return stop_ids;
+    };
+
+    const auto source_ids = to_stop_ids(sources);
+    const auto target_ids = to_stop_ids(targets);
+    if(!source_ids || !target_ids) {
+        JSON_builder.StartDict()
+                    .Key("error_message"s).Value("not found"s)
+                    .Key("request_id"s).Value(id_request)
+                    .EndDict();
+        return;
+    }
+
+    JSON_builder.StartDict().Key("request_id"s).Value(id_request);
+
+    const auto matrix = QueryRouter([this, &source_ids, &target_ids] {
+        return router_->ComputeTravelTimeMatrix(*source_ids, *target_ids);
+    });
+
+    JSON_builder.Key("times"s).StartArray();
+    for(const auto& row : matrix) {
+        JSON_builder.StartArray();
+
+        for(const auto& time : row) {
+            if(time) {
+                JSON_builder.Value(*time);
+            } else {
+                JSON_builder.Value(nullptr);
+            }
+        }
+        JSON_builder.EndArray();
+    }
+    JSON_builder.EndArray()
+                .EndDict();
+}
+
+void JSONReader::ApplyCommandToNearbyStops(const int id_request, const vector<spatial_index::NearbyStop>& stops,
+                                           Writer& JSON_builder) const {
+    JSON_builder.StartDict().Key("request_id"s).Value(id_request)
+                .Key("stops"s).StartArray();
+
+    for(const auto& [stop, distance] : stops) {
+        JSON_builder.StartDict()
+                    .Key("distance"s).Value(distance)
+                    .Key("name"s).Value(stop->name_stop)
+                    .EndDict();
+    }
+
+    JSON_builder.EndArray()
+                .EndDict();
+}
+
 void JSONReader::LoadSettingsForRenderer() {
-    const auto iter_command = doc_.GetRoot().AsDict().find("render_settings"s);
+    const json::Node* settings_node = FindSettings("render_settings"s);
 
-    if(iter_command == doc_.GetRoot().AsDict().end()) {
+    if(!settings_node) {
         return; 
     }
 
-    const auto dict = iter_command->second.AsDict();
+    const auto dict = settings_node->AsDict();
 
     if(dict.empty()) {
         return;
     }
 
-    for(const auto& [key, value] : dict) {
+    for(const auto& [setting, value] : dict) {
+        const string key(setting);
+
         if(value.IsInt()) {
             renderer_->ApplySetting<int>(key, value.AsInt());
             continue;
@@ -272,7 +365,7 @@ void JSONReader::LoadSettingsForRenderer() {
         }
         
         if(value.IsString()) {
-            svg::Color color (value.AsString());
+            svg::Color color (string(value.AsString()));
             renderer_->ApplySetting(key, color);
         }
 
@@ -280,7 +373,7 @@ void JSONReader::LoadSettingsForRenderer() {
             for(const auto& elem : value.AsArray()) {
 
                 if(elem.IsString()) {
-                    svg::Color color (elem.AsString());
+                    svg::Color color (string(elem.AsString()));
                     renderer_->ApplySetting(key, color);
                     continue;
                 }
@@ -297,13 +390,13 @@ void JSONReader::LoadSettingsForRenderer() {
 }
 
 void JSONReader::LoadSettingsForRouter() {
-    const auto iter_command = doc_.GetRoot().AsDict().find("routing_settings"s);
+    const json::Node* settings_node = FindSettings("routing_settings"s);
 
-    if(iter_command == doc_.GetRoot().AsDict().end()) {
+    if(!settings_node) {
         return; 
     };
 
-    const auto dict = iter_command->second.AsDict();
+    const auto dict = settings_node->AsDict();
 
     if(dict.empty()) {
         return;
@@ -311,73 +404,203 @@ void JSONReader::LoadSettingsForRouter() {
     router::SettingsTransportRouter settings;
 
     for(const auto& [key, value] : dict) {
-        if(key == "bus_wait_time"s) {
+        if(key == "bus_wait_time"sv) {
             settings.wait_time = value.AsInt();
         }
         
-        if(key == "bus_velocity"s) {
+        if(key == "bus_velocity"sv) {
             settings.velocity = value.AsDouble();
         }
+
+        if(key == "routing_engine"sv) {
+            settings.engine = router::ParseRoutingEngine(value.AsString());
+        }
+
+        if(key == "routing_threads"sv) {
+            settings.thread_count = static_cast<size_t>(std::max(value.AsInt(), 0));
+        }
+
+        if(key == "route_table_precision"sv) {
+            settings.float_route_table = value.AsString() == "float"s;
+        }
+
+        if(key == "route_table_tolerance"sv) {
+            settings.route_table_tolerance = value.AsDouble();
+        }
+
+        if(key == "routing_index_file"sv) {
+            settings.index_path = value.AsString();
+        }
+
+        if(key == "routing_index_verify"sv) {
+            settings.verify_index_table = value.AsBool();
+        }
     }
 
     router_ = std::make_unique<router::TransportRouter>(settings, *catalogue_);
 }
 
-void JSONReader::PrepareJSON(const Array& array_in, Builder& JSON_builder) const {
+void JSONReader::ParseStatRequest(const Node& dict, StatRequest& request, string& key_err) const {
+    key_err = "stat_requests Dicts"s;
+
+    for(const auto& [key, value] : dict.AsDict()) {
+        key_err = key;
+
+        if(key == "id"sv) {
+            request.id = value.AsInt();
+        }
+
+        if(key == "type"sv) {
+            request.type = value.AsString();
+        }
+
+        if(key == "name"sv) {
+            request.name = value.AsString();
+        } 
+
+        if(key == "from"sv) {
+            request.from = value.AsString();
+        }
+
+        if(key == "to"sv) {
+            request.to = value.AsString();
+        }
+
+        if(key == "latitude"sv) {
+            request.point.lat = value.AsDouble();
+        }
+
+        if(key == "longitude"sv) {
+            request.point.lng = value.AsDouble();
+        }
+
+        if(key == "count"sv) {
+            request.count = value.AsInt();
+        }
+
+        if(key == "radius"sv) {
+            request.radius = value.AsDouble();
+        }
+
+        if(key == "sources"sv || key == "targets"sv) {
+            auto& stops = key == "sources"sv ? request.sources : request.targets;
+            stops.clear();
+
+            for(const auto& stop : value.AsArray()) {
+                stops.emplace_back(stop.AsString());
+            }
+        }
+    }
+}
+
+vector<optional<RouterEngine<double>::RouteInfo>> JSONReader::BuildRoutesForRequests(
+    const vector<StatRequest>& requests) const {
+    vector<optional<RouterEngine<double>::RouteInfo>> routes(requests.size());
+
+    //Имена остановок переводятся в id один раз. Запрос с неизвестной остановкой остается без маршрута
+    std::unordered_map<StopId, vector<std::pair<size_t, StopId>>> route_requests_by_from;
+    for(size_t i = 0; i < requests.size(); ++i) {
+        if(requests[i].type != "Route"s) {
+            continue;
+        }
+
+        const Stop* stop_from = catalogue_->FindStop(requests[i].from);
+        const Stop* stop_to = catalogue_->FindStop(requests[i].to);
+        if(stop_from && stop_to) {
+            route_requests_by_from[stop_from->id].emplace_back(i, stop_to->id);
+        }
+    }
+
+    for(const auto& [stop_from, indexes] : route_requests_by_from) {
+        vector<StopId> stops_to;
+        stops_to.reserve(indexes.size());
+
+        for(const auto& [index, stop_to] : indexes) {
+            stops_to.push_back(stop_to);
+        }
+
+        auto routes_from = QueryRouter([this, stop_from = stop_from, &stops_to] {
+            return router_->BuildOptimazedRoutes(stop_from, stops_to);
+        });
+        for(size_t i = 0; i < indexes.size(); ++i) {
+            routes[indexes[i].first] = std::move(routes_from[i]);
+        }
+    }
+
+    return routes;
+}
+
+void JSONReader::PrepareJSON(const Array& array_in, Writer& JSON_builder) const {
     using namespace json;
 
     JSON_builder.StartArray();
 
     string key_err;
-    string type_request;
-    string name_for_type;
-    int id_request = 0;
-
-    string stop_from;
-    string stop_to;
     
     try {
-        for(const auto& dict : array_in) {
-            key_err = "stat_requests Dicts"s;
+        //Поля, которых нет в запросе, остаются от предыдущего
+        StatRequest parsed_request;
+
+        for(size_t window_begin = 0; window_begin < array_in.size(); window_begin += STAT_REQUEST_WINDOW_SIZE) {
+            const size_t window_end = std::min(window_begin + STAT_REQUEST_WINDOW_SIZE, array_in.size());
+
+            //Ошибка разбора обрывает окно: ответы на запросы до нее печатаются, после - нет
+            vector<StatRequest> requests;
+            requests.reserve(window_end - window_begin);
+            string parse_key_err;
+            std::exception_ptr parse_error;
+            try {
+                for(size_t i = window_begin; i < window_end; ++i) {
+                    ParseStatRequest(array_in[i], parsed_request, parse_key_err);
+                    requests.push_back(parsed_request);
+                }
+            } catch(...) {
+                parse_error = std::current_exception();
+            }
 
-            for(const auto& [key, value] : dict.AsDict()) {
-                key_err = key;
+            key_err = "Route"s;
+            auto routes = BuildRoutesForRequests(requests);
 
-                if(key == "id"s) {
-                    id_request = value.AsInt();
-                }
+            for(size_t i = 0; i < requests.size(); ++i) {
+                const auto& request = requests[i];
+                key_err = request.type;
+
+                if(request.type == "Bus"s) {
+                    ApplyCommandToBusInfo(request.id, request.name, JSON_builder);
+                } 
 
-                if(key == "type"s) {
-                    type_request = value.AsString();
+                if(request.type == "Stop"s) {
+                    ApplyCommandToStopInfo(request.id, request.name, JSON_builder);
                 }
 
-                if(key == "name"s) {
-                    name_for_type = value.AsString();
+                if(request.type == "Map"s) {
+                    ApplyCommandToMapInfo(request.id, JSON_builder);
                 } 
+                
+                if(request.type == "Route"s) {
+                    ApplyCommandToRouteInfo(request.id, routes[i], JSON_builder);
+                }
 
-                if(key == "from"s) {
-                    stop_from = value.AsString();
+                if(request.type == "Matrix"s) {
+                    ApplyCommandToMatrixInfo(request.id, request.sources, request.targets, JSON_builder);
                 }
 
-                if(key == "to"s) {
-                    stop_to = value.AsString();
+                if(request.type == "NearestStops"s) {
+                    ApplyCommandToNearbyStops(request.id,
+                                              stop_index_->FindNearest(request.point,
+                                                                       static_cast<size_t>(std::max(request.count, 0))),
+                                              JSON_builder);
                 }
-            }
-       
-            if(type_request == "Bus"s) {
-                ApplyCommandToBusInfo(id_request, name_for_type, JSON_builder);
-            } 
 
-            if(type_request == "Stop"s) {
-                ApplyCommandToStopInfo(id_request, name_for_type, JSON_builder);
+                if(request.type == "StopsInArea"s) {
+                    ApplyCommandToNearbyStops(request.id, stop_index_->FindInRadius(request.point, request.radius),
+                                              JSON_builder);
+                }
             }
 
-            if(type_request == "Map"s) {
-                ApplyCommandToMapInfo(id_request, JSON_builder);
-            } 
-            
-            if(type_request == "Route"s) {
-                ApplyCommandToRouteInfo(id_request, stop_from, stop_to, JSON_builder);
+            if(parse_error) {
+                key_err = parse_key_err;
+                std::rethrow_exception(parse_error);
             }
         }
 
@@ -391,28 +614,295 @@ void JSONReader::PrepareJSON(const Array& array_in, Builder& JSON_builder) const
     }
 }
 
-void JSONReader::LoadTransportCatalogue() {
-    const auto iter_command = doc_.GetRoot().AsDict().find("base_requests"s);
+const json::Node* JSONReader::FindSettings(const std::string& key) const {
+    if(const auto iter = doc_.GetRoot().AsDict().find(key); iter != doc_.GetRoot().AsDict().end()) {
+        return &iter->second;
+    }
 
-    if(iter_command == doc_.GetRoot().AsDict().end()) {
-        return; 
+    if(snapshot_settings_.IsDict()) {
+        if(const auto iter = snapshot_settings_.AsDict().find(key); iter != snapshot_settings_.AsDict().end()) {
+            return &iter->second;
+        }
     }
 
-    const Array* data_of_transport_catalogue = &iter_command->second.AsArray();
-    
-    for(const auto& element : *data_of_transport_catalogue) {
+    return nullptr;
+}
+
+std::optional<std::string> JSONReader::GetSnapshotPath() const {
+    const json::Node* settings_node = FindSettings("serialization_settings"s);
+
+    if(!settings_node) {
+        return std::nullopt;
+    }
+
+    const auto& dict = settings_node->AsDict();
+    if(const auto iter = dict.find("file"s); iter != dict.end()) {
+        return string(iter->second.AsString());
+    }
+    return std::nullopt;
+}
+
+void JSONReader::LoadBaseRequests(const json::Array& base_requests) {
+    for(const auto& element : base_requests) {
         ApplyCommandToStop(element);
     }
 
-    for(const auto& element : *data_of_transport_catalogue) {
+    for(const auto& element : base_requests) {
         ApplyCommandToDistance(element);
     }
 
-    for(const auto& element : *data_of_transport_catalogue) {
+    for(const auto& element : base_requests) {
         ApplyCommandToBus(element);
     }
 }
 
+//Корень документа собирается в Dict, значения разделов - через Builder. Элементы base_requests
+//передаются в справочник сразу: остановки с расстояниями до уже известных остановок добавляются
+//немедленно, остальные расстояния и маршруты - когда массив base_requests закончится.
+//Разделы лежат в арене документа. Элемент base_requests собирается в отдельной арене, которая
+//очищается после каждого элемента, а отложенные элементы копируются в кучу
+class JSONReader::StreamHandler final : public json::Handler {
+public:
+    explicit StreamHandler(JSONReader& reader)
+        : reader_(reader)
+        , arena_(std::make_shared<std::pmr::monotonic_buffer_resource>())
+        , root_(arena_.get())
+        , request_buffer_(REQUEST_BUFFER_SIZE)
+        , request_arena_(request_buffer_.data(), request_buffer_.size()) {
+    }
+
+    void StartDict() override {
+        StartContainer(/* is_dict */ true);
+    }
+
+    void Key(string_view key) override {
+        if(builder_) {
+            if(builder_->HasKey(key)) {
+                throw ParsingError("Duplicate key '"s + string(key) + "' have been found");
+            }
+            builder_->Key(key);
+        } else {
+            section_ = key;
+        }
+    }
+
+    void EndDict() override {
+        EndContainer(/* is_dict */ true);
+    }
+
+    void StartArray() override {
+        StartContainer(/* is_dict */ false);
+    }
+
+    void EndArray() override {
+        EndContainer(/* is_dict */ false);
+    }
+
+    void Value(Node value) override {
+        if(depth_ == 0) {
+            throw ParsingError("Document root should be a dict"s);
+        }
+
+        if(builder_) {
+            builder_->Value(std::move(value));
+        } else {
+            CompleteValue(std::move(value));
+        }
+    }
+
+    void String(string_view value) override {
+        Value(Node(json::String(value, GetResource())));
+    }
+
+    Document ExtractDocument() {
+        return Document(Node(std::move(root_)), arena_);
+    }
+
+private:
+    static constexpr size_t REQUEST_BUFFER_SIZE = 1 << 16;
+
+    //Память собираемого значения
+    std::pmr::memory_resource* GetResource() {
+        if(in_base_requests_) {
+            return &request_arena_;
+        }
+        return arena_.get();
+    }
+
+    //Глубина, на которой лежат собираемые значения: разделы корня или элементы base_requests
+    size_t GetValueDepth() const {
+        return in_base_requests_ ? 2 : 1;
+    }
+
+    void StartContainer(bool is_dict) {
+        if(depth_ == 0 && !is_dict) {
+            throw ParsingError("Document root should be a dict"s);
+        }
+
+        if(!builder_ && depth_ == 1 && !is_dict && section_ == "base_requests"s) {
+            if(reader_.is_catalogue_streamed_) {
+                throw ParsingError("Duplicate key '"s + section_ + "' have been found");
+            }
+            in_base_requests_ = true;
+            reader_.is_catalogue_streamed_ = true;
+        } else if(depth_ > 0) {
+            if(!builder_) {
+                builder_.emplace(GetResource(), &scratch_);
+            }
+
+            if(is_dict) {
+                builder_->StartDict();
+            } else {
+                builder_->StartArray();
+            }
+        }
+
+        ++depth_;
+    }
+
+    void EndContainer(bool is_dict) {
+        --depth_;
+
+        if(builder_) {
+            if(is_dict) {
+                builder_->EndDict();
+            } else {
+                builder_->EndArray();
+            }
+
+            if(depth_ == GetValueDepth()) {
+                CompleteValue(builder_->Build());
+            }
+        } else if(in_base_requests_ && depth_ == 1) {
+            in_base_requests_ = false;
+            FinishBaseRequests();
+        }
+    }
+
+    void CompleteValue(Node value) {
+        builder_.reset();
+
+        if(in_base_requests_) {
+            AddBaseRequest(std::move(value));
+            request_arena_.release();
+        } else if(!root_.emplace(section_, std::move(value)).second) {
+            throw ParsingError("Duplicate key '"s + section_ + "' have been found");
+        }
+    }
+
+    void AddBaseRequest(Node request) {
+        if(!request.IsDict()) {
+            reader_.ApplyCommandToStop(request);
+            return;
+        }
+
+        const auto& dict = request.AsDict();
+        const auto type = dict.find("type"s);
+
+        //Номера маршрутов идут в порядке входа, а длины считаются, когда все расстояния известны
+        //Отложенный элемент копируется: арена элемента очистится раньше, чем он понадобится
+        if(type != dict.end() && type->second == Node("Bus"s)) {
+            pending_buses_.push_back(request);
+            return;
+        }
+
+        reader_.ApplyCommandToStop(request);
+
+        const auto distances = dict.find("road_distances"s);
+        const bool has_unknown_stops = distances != dict.end() && distances->second.IsDict()
+            && std::any_of(distances->second.AsDict().begin(), distances->second.AsDict().end(),
+                           [this](const auto& distance) {
+                               return !reader_.catalogue_->FindStop(distance.first);
+                           });
+
+        if(has_unknown_stops) {
+            pending_distances_.push_back(request);
+        } else {
+            reader_.ApplyCommandToDistance(request);
+        }
+    }
+
+    void FinishBaseRequests() {
+        for(const auto& request : pending_distances_) {
+            reader_.ApplyCommandToDistance(request);
+        }
+
+        for(const auto& request : pending_buses_) {
+            reader_.ApplyCommandToBus(request);
+        }
+
+        vector<Node>().swap(pending_distances_);
+        vector<Node>().swap(pending_buses_);
+    }
+
+    JSONReader& reader_;
+    std::shared_ptr<std::pmr::monotonic_buffer_resource> arena_;  //Арена документа
+    Dict root_;
+    string section_;    //Текущий раздел корня
+    size_t depth_ = 0;  //Число открытых массивов и словарей
+    bool in_base_requests_ = false;
+
+    vector<std::byte> request_buffer_;  //Начальный блок арены элемента, переиспользуется
+    std::pmr::monotonic_buffer_resource request_arena_;
+    std::pmr::unsynchronized_pool_resource scratch_;  //Открытые контейнеры Builder, память переиспользуется
+    std::optional<Builder> builder_;  //Значение, которое собирается сейчас, в текущей арене
+
+    vector<Node> pending_distances_;  //Остановки с расстояниями до еще не встреченных остановок
+    vector<Node> pending_buses_;
+};
+
+string JSONReader::ReadInput(std::istream& input) {
+    string buffer;
+    char chunk[1 << 16];
+
+    while(input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        buffer.append(chunk, static_cast<size_t>(input.gcount()));
+    }
+
+    return buffer;
+}
+
+Document JSONReader::LoadStreaming(std::istream& input) {
+    StreamHandler handler(*this);
+    json::Parse(input, handler);
+    return handler.ExtractDocument();
+}
+
+void JSONReader::LoadTransportCatalogue() {
+    const auto iter_command = doc_.GetRoot().AsDict().find("base_requests"s);
+    const std::optional<std::string> snapshot_path = GetSnapshotPath();
+
+    if(is_catalogue_streamed_ || iter_command != doc_.GetRoot().AsDict().end()) {
+        if(!is_catalogue_streamed_) {
+            LoadBaseRequests(iter_command->second.AsArray());
+        }
+
+        //В снимок вместе со справочником попадают настройки, нужные для ответов на stat_requests
+        if(snapshot_path) {
+            json::Dict settings;
+            for(const auto& key : {"render_settings"s, "routing_settings"s}) {
+                if(const json::Node* settings_node = FindSettings(key)) {
+                    settings.emplace(key, *settings_node);
+                }
+            }
+            try {
+                catalogue_snapshot::Save(*catalogue_, json::Node(std::move(settings)), *snapshot_path);
+            } catch(const std::exception& err) {
+                cerr << err.what() << '\n';
+            }
+        }
+    } else if(snapshot_path) {
+        //Поврежденный или чужой снимок не мешает ответить на запросы: справочник остается пустым
+        if(!catalogue_snapshot::Load(*snapshot_path, *catalogue_, snapshot_settings_)) {
+            cerr << "Failed to load catalogue snapshot "s << *snapshot_path << '\n';
+        }
+    }
+
+    //Дальше справочник только читается. Пустой индекс отвечает на запросы по области пустым списком
+    catalogue_->Freeze();
+    stop_index_ = std::make_unique<spatial_index::StopIndex>(catalogue_->GetStops(true));
+}
+
 void JSONReader::LoadSettings() {
     LoadSettingsForRenderer();
     LoadSettingsForRouter();
@@ -427,12 +917,13 @@ void JSONReader::PrintJSON(std::ostream& out) const {
         return; 
     }
     
-    Array array_in = iter_command->second.AsArray();
+    const Array& array_in = iter_command->second.AsArray();
     if(array_in.empty()) {
         return;
     }
 
-    Builder JSON_builder;
+    //Ответы печатаются по мере готовности. После исключения Close дописывает закрывающие скобки
+    Writer JSON_builder(out);
     PrepareJSON(array_in, JSON_builder);
-    Print (Document(JSON_builder.Build()), out);
+    JSON_builder.Close();
 }
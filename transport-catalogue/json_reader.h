@@ -1,24 +1,38 @@
 #pragma once
 
 #include <iostream>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <sstream>
+#include <vector>
 
+#include "catalogue_snapshot.h"
 #include "domain.h"
 #include "graph.h"
 #include "json.h"
 #include "json_builder.h"
+#include "json_writer.h"
 #include "request_handler.h"
 #include "router.h"
+#include "spatial_index.h"
 #include "svg.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
 class JSONReader {
 public:
-    explicit JSONReader(std::istream& input) 
-        :  doc_ (json::Load(input)) { 
+    //DOCUMENT строит дерево всего входа. STREAMING разбирает вход потоково: base_requests
+    //по одному элементу уходят в справочник, в дереве остаются только остальные разделы
+    enum class InputMode {
+        DOCUMENT,
+        STREAMING,
+    };
+
+    explicit JSONReader(std::istream& input, InputMode mode = InputMode::DOCUMENT) 
+        :  doc_ (json::Node(nullptr)) { 
+        //Потоковый разбор сразу наполняет справочник, поэтому запускается, когда все поля уже созданы
+        doc_ = mode == InputMode::STREAMING ? LoadStreaming(input) : json::Load(ReadInput(input));
         request_handler = std::make_unique<RequestHandler>(*catalogue_, *renderer_, *router_); 
     }
 
@@ -32,28 +46,84 @@ private:
     std::unique_ptr<TransportCatalogue> catalogue_ = std::make_unique<TransportCatalogue>(); 
     std::unique_ptr<renderer::MapRenderer> renderer_ = std::make_unique<renderer::MapRenderer>();
     std::unique_ptr<router::TransportRouter> router_ = nullptr;
+    std::unique_ptr<spatial_index::StopIndex> stop_index_ = nullptr;
+
+    bool is_catalogue_streamed_ = false;  //base_requests уже загружены при потоковом разборе
 
     json::Document doc_;
-    domain::Stop stop;
+    json::Node snapshot_settings_;  //Настройки, загруженные из снимка справочника
+
+    struct StatRequest {
+        int id = 0;
+        std::string type;
+        std::string name;
+        std::string from;
+        std::string to;
+        std::vector<std::string> sources;  //Остановки строк и столбцов Matrix-запроса
+        std::vector<std::string> targets;
+        geo::Coordinates point{0., 0.};    //Точка NearestStops- и StopsInArea-запросов
+        int count = 0;                     //Сколько ближайших остановок вернуть
+        double radius = 0.;                //Радиус области в метрах
+    };
     
     
+    class StreamHandler;
+
+    //DOCUMENT читает вход целиком и разбирает как непрерывный буфер
+    static std::string ReadInput(std::istream& input);
+    //STREAMING разбирает сам поток, не копируя вход в память
+    json::Document LoadStreaming(std::istream& input);
+
     void ApplyArrayOfColorCharacteristics(const std::string& key, const json::Node& array);
 
     void ApplyCommandToStop(const json::Node& node);
     void ApplyCommandToDistance(const json::Node& node);
     void ApplyCommandToBus(const json::Node& node);
 
-    void ApplyCommandToBusInfo(const int id_request, const std::string& name_bus, json::Builder&  JSON_builder) const;
-    void ApplyCommandToStopInfo(const int id_request, const std::string& name_stop, json::Builder& JSON_builder) const;
-    void ApplyCommandToMapInfo(const int id_request, json::Builder& JSON_builder) const;
+    void ApplyCommandToBusInfo(const int id_request, const std::string& name_bus, json::Writer& JSON_builder) const;
+    void ApplyCommandToStopInfo(const int id_request, const std::string& name_stop, json::Writer& JSON_builder) const;
+    void ApplyCommandToMapInfo(const int id_request, json::Writer& JSON_builder) const;
     void ApplyCommandToRouteInfo(const int id_request, 
-                                 const std::string& stop_from, 
-                                 const std::string& stop_to,
-                                 json::Builder& JSON_builder) const;
+                                 const std::optional<graph::RouterEngine<double>::RouteInfo>& route,
+                                 json::Writer& JSON_builder) const;
+    void ApplyCommandToMatrixInfo(const int id_request, const std::vector<std::string>& sources,
+                                  const std::vector<std::string>& targets, json::Writer& JSON_builder) const;
+    //Ответ NearestStops и StopsInArea: остановки с расстояниями по возрастанию расстояния
+    void ApplyCommandToNearbyStops(const int id_request, const std::vector<spatial_index::NearbyStop>& stops,
+                                   json::Writer& JSON_builder) const;
+
+    //Настройки из входного JSON, а если их там нет - из загруженного снимка. nullptr, если нет нигде
+    const json::Node* FindSettings(const std::string& key) const;
+    std::optional<std::string> GetSnapshotPath() const;
+    void LoadBaseRequests(const json::Array& base_requests);
 
     void LoadSettingsForRenderer();
     void LoadSettingsForRouter();
 
-    void PrepareJSON(const json::Array& array_in, json::Builder&) const;
+    //Дописывает в request поля запроса dict, остальные поля остаются от предыдущего запроса
+    void ParseStatRequest(const json::Node& dict, StatRequest& request, std::string& key_err) const;
+
+    //Запросы разбираются и выполняются окнами: ответы печатаются по ходу,
+    //поэтому в памяти лежат запросы и маршруты только одного окна
+    static constexpr size_t STAT_REQUEST_WINDOW_SIZE = 16384;
+
+    //Запрос к роутеру. Поврежденная таблица из файла индекса обнаруживается при запросе:
+    //тогда роутер чинит индекс, и запрос повторяется
+    template <typename Query>
+    auto QueryRouter(Query query) const {
+        try {
+            return query();
+        } catch(const router::CorruptedIndexError& err) {
+            std::cerr << err.what() << ", rebuilding it\n";
+            router_->RepairIndex();
+            return query();
+        }
+    }
+
+    //Считает Route-запросы окна пачками по остановке отправления, результат - по индексу запроса
+    std::vector<std::optional<graph::RouterEngine<double>::RouteInfo>> BuildRoutesForRequests(
+        const std::vector<StatRequest>& requests) const;
+
+    void PrepareJSON(const json::Array& array_in, json::Writer&) const;
 };
 
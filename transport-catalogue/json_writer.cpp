@@ -0,0 +1,133 @@
+#include "json_writer.h"
+
+using namespace std::literals;
+
+namespace json {
+//--------------------WRITER----------------------
+Writer::DictItemContext Writer::StartDict() {
+    BeginItem();
+    out_ << "{\n"sv;
+    levels_.push_back({/* is_dict */ true});
+    return BaseContext{*this};
+}
+
+Writer::ArrayItemContext Writer::StartArray() {
+    BeginItem();
+    out_ << "[\n"sv;
+    levels_.push_back({/* is_dict */ false});
+    return BaseContext{*this};
+}
+
+Writer::DictValueContext Writer::Key(std::string_view key) {
+    if (levels_.empty() || !levels_.back().is_dict || levels_.back().has_key) {
+        throw std::logic_error("Key outside of dict"s);
+    }
+
+    Level& level = levels_.back();
+    if (!level.is_empty && key <= level.last_key) {
+        throw std::logic_error("Key \""s + std::string(key) + "\" goes after \""s + level.last_key + "\""s);
+    }
+
+    if (!level.is_empty) {
+        out_ << ",\n"sv;
+    }
+    level.is_empty = false;
+    level.has_key = true;
+    level.last_key = key;
+
+    out_ << std::string(GetIndent(), ' ');
+    Print(Node(String(key)), out_, 0);
+    out_ << ": "sv;
+    return BaseContext{*this};
+}
+
+Writer::BaseContext Writer::Value(Node value) {
+    BeginItem();
+    Print(value, out_, GetIndent());
+
+    if (levels_.empty()) {
+        is_finished_ = true;
+    }
+    return *this;
+}
+
+Writer::BaseContext Writer::EndDict() {
+    EndContainer(/* is_dict */ true, '}');
+    return *this;
+}
+
+Writer::BaseContext Writer::EndArray() {
+    EndContainer(/* is_dict */ false, ']');
+    return *this;
+}
+
+void Writer::Close() {
+    while (!levels_.empty()) {
+        if (levels_.back().has_key) {
+            Value(nullptr);
+        }
+
+        if (levels_.back().is_dict) {
+            EndDict();
+        } else {
+            EndArray();
+        }
+    }
+}
+
+void Writer::BeginItem() {
+    if (is_finished_) {
+        throw std::logic_error("Attempt to change finalized JSON"s);
+    }
+
+    if (levels_.empty()) {
+        return;
+    }
+
+    Level& level = levels_.back();
+    if (level.is_dict) {
+        if (!level.has_key) {
+            throw std::logic_error("New object in wrong context"s);
+        }
+        level.has_key = false;
+        return;
+    }
+
+    if (!level.is_empty) {
+        out_ << ",\n"sv;
+    }
+    level.is_empty = false;
+    out_ << std::string(GetIndent(), ' ');
+}
+
+void Writer::EndContainer(bool is_dict, char bracket) {
+    if (levels_.empty() || levels_.back().is_dict != is_dict || levels_.back().has_key) {
+        throw std::logic_error("Unexpected end of "s + (is_dict ? "dict"s : "array"s));
+    }
+
+    levels_.pop_back();
+    out_.put('\n');
+    out_ << std::string(GetIndent(), ' ');
+    out_.put(bracket);
+
+    if (levels_.empty()) {
+        is_finished_ = true;
+    }
+}
+
+int Writer::GetIndent() const {
+    return static_cast<int>(levels_.size()) * 4;
+}
+
+//--------------------DICTVALUECONTEXT----------------------
+Writer::DictItemContext Writer::DictValueContext::Value(Node value) {
+    Writer::BaseContext::Value(std::move(value));
+    return BaseContext {*this};
+}
+
+//--------------------ARRAYITEMCONTEXT----------------------
+Writer::ArrayItemContext Writer::ArrayItemContext::Value(Node value) {
+    Writer::BaseContext::Value(std::move(value));
+    return BaseContext {*this};
+}
+}  // namespace json
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+namespace json {
+//Потоковая запись JSON с тем же интерфейсом, что у Builder: элементы сразу печатаются в out
+//в формате json::Print, в памяти хранится только стек открытых массивов и словарей.
+//Ключи словаря печатаются в порядке вызовов Key, поэтому должны идти по возрастанию, как у Print:
+//ключ не больше предыдущего - logic_error
+class Writer {
+    class BaseContext;
+    class DictItemContext;
+    class DictValueContext;
+    class ArrayItemContext;
+public:
+    explicit Writer(std::ostream& out) : out_(out) {
+    }
+
+    DictItemContext StartDict();
+    ArrayItemContext StartArray();
+
+    DictValueContext Key(std::string_view key);
+
+    BaseContext Value(Node value);
+    BaseContext EndDict();
+    BaseContext EndArray();
+
+    //Закрывает все открытые массивы и словари, ключ без значения получает null. Так
+    //прерванная исключением запись остается корректным JSON, как дерево недостроенного Builder
+    void Close();
+
+private:
+    struct Level {
+        bool is_dict = false;
+        bool is_empty = true;
+        bool has_key = false;  //Ключ напечатан, значение еще нет
+        std::string last_key{};
+    };
+
+    std::ostream& out_;
+    std::vector<Level> levels_;
+    bool is_finished_ = false;
+
+    //Перевод строки и отступ перед новым элементом массива; в словаре элемент идет после ключа
+    void BeginItem();
+    void EndContainer(bool is_dict, char bracket);
+    int GetIndent() const;
+
+    class BaseContext {
+    public:
+        BaseContext(Writer& writer) : writer_(writer) {
+        }
+
+        DictItemContext StartDict() {
+            return writer_.StartDict();
+        }
+
+        ArrayItemContext StartArray() {
+            return writer_.StartArray();
+        }
+
+        DictValueContext Key(std::string_view key) {
+            return writer_.Key(key);
+        }
+
+        BaseContext Value(Node value) {
+            return writer_.Value(std::move(value));
+        }
+
+        BaseContext EndDict() {
+            return writer_.EndDict();
+        }
+
+        BaseContext EndArray() {
+            return writer_.EndArray();
+        }
+    private:
+        Writer& writer_;
+    };
+
+    class DictItemContext : public BaseContext {
+    public:
+        DictItemContext(BaseContext base) : BaseContext(base) {
+        }
+
+        DictItemContext StartDict() = delete;
+        ArrayItemContext StartArray() = delete;
+        BaseContext Value(Node value) = delete;
+        BaseContext EndArray() = delete;
+    };
+
+    class DictValueContext : public BaseContext {
+    public:
+        DictValueContext(BaseContext base) : BaseContext(base) {
+        }
+
+        DictItemContext Value(Node value);
+
+        DictValueContext Key(std::string_view key) = delete;
+        BaseContext EndDict() = delete;
+        BaseContext EndArray() = delete;
+    };
+
+    class ArrayItemContext : public BaseContext {
+    public:
+        ArrayItemContext(BaseContext base) : BaseContext(base) {
+        }
+
+        ArrayItemContext Value(Node value);
+
+        DictValueContext Key(std::string_view key) = delete;
+        BaseContext EndDict() = delete;
+    };
+};
+}  // namespace json
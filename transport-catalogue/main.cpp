@@ -8,7 +8,7 @@
 using namespace std;
 
 int main() {
-    JSONReader json(std::cin);
+    JSONReader json(std::cin, JSONReader::InputMode::STREAMING);
 
     json.LoadTransportCatalogue();
     json.LoadSettings();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -12,6 +13,7 @@ class Range {
 public:
     using ValueType = typename std::iterator_traits<It>::value_type;
 
+    Range() = default;
     Range(It begin, It end)
         : begin_(begin)
         , end_(end) {
@@ -23,9 +25,20 @@ public:
         return end_;
     }
 
+    //Только для итераторов произвольного доступа
+    size_t size() const {
+        return static_cast<size_t>(end_ - begin_);
+    }
+    bool empty() const {
+        return begin_ == end_;
+    }
+    decltype(auto) operator[](size_t index) const {
+        return begin_[index];
+    }
+
 private:
-    It begin_;
-    It end_;
+    It begin_{};
+    It end_{};
 };
 
 template <typename C>
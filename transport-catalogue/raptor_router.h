@@ -0,0 +1,364 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+//Движок RAPTOR: поиск по раундам, раунд k - лучшие пути ровно с k поездками.
+//Линия - цепочка ребер графа, по которой едут без пересадки: после ребра line[p] можно сразу
+//продолжить по line[p + 1]. Остальные ребра графа - пересадочные (ожидание), они релаксируются
+//между раундами. Граф линейный по числу остановок на маршрутах: вместо ребра на каждую пару
+//остановок маршрута хватает ребра на каждый перегон.
+//Поездка в маршруте - подряд идущие ребра одной линии, каждое со своим весом перегона
+template <typename Weight>
+class RaptorRouter final : public RouterEngine<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterEngine<Weight>::RouteInfo;
+
+    RaptorRouter(const Graph& graph, std::vector<std::vector<EdgeId>> lines);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    //Один поиск из from, пока не улучшаются пути хотя бы до одной из целей
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override;
+
+    size_t GetMemoryFootprint() const override;
+
+protected:
+    std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from,
+                                                           const std::vector<VertexId>& targets) const override;
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+
+    //Как вершина достигнута в раунде: пересадочным ребром, поездкой по линии или это начало пути
+    struct Label {
+        std::optional<Weight> weight;
+        EdgeId transfer_edge = NO_EDGE;
+        size_t line = NO_POSITION;
+        size_t board = 0;   //Позиции первого и последнего ребра поездки в линии
+        size_t alight = 0;
+        size_t prev_round = 0;  //Раунд, в котором достигнута предыдущая вершина пути
+    };
+
+    struct SearchResult {
+        std::vector<std::optional<Weight>> weights;
+        std::vector<size_t> rounds_of_weights;  //Раунд, в котором найден вес из weights
+        std::vector<std::vector<Label>> rounds;
+    };
+
+    struct LinePosition {
+        size_t line;
+        size_t position;
+    };
+
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    SearchResult Search(VertexId from, const std::vector<VertexId>& targets) const;
+
+    //Поездки по линиям, проходящим через вершины marked. Возвращает вершины, улучшенные в раунде
+    std::vector<VertexId> ScanLines(const std::vector<VertexId>& marked, std::optional<Weight> bound,
+                                    SearchResult& result) const;
+
+    //Дейкстра по пересадочным ребрам из вершин marked, дополняет marked достигнутыми вершинами
+    void RelaxTransfers(std::vector<VertexId>& marked, std::optional<Weight> bound, SearchResult& result) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<std::vector<EdgeId>> lines_;
+    std::vector<std::vector<LinePosition>> line_positions_;  //По вершине: ребра линий, выходящие из нее
+    std::vector<std::vector<EdgeId>> transfer_edges_;       //По вершине: пересадочные ребра из нее
+};
+
+template <typename Weight>
+RaptorRouter<Weight>::RaptorRouter(const Graph& graph, std::vector<std::vector<EdgeId>> lines)
+    : graph_(graph)
+    , lines_(std::move(lines))
+    , line_positions_(graph.GetVertexCount())
+    , transfer_edges_(graph.GetVertexCount()) {
+    std::vector<bool> is_line_edge(graph.GetEdgeCount());
+
+    for (size_t line = 0; line < lines_.size(); ++line) {
+        for (size_t position = 0; position < lines_[line].size(); ++position) {
+            const EdgeId edge_id = lines_[line][position];
+            if (edge_id >= graph.GetEdgeCount()) {
+                throw std::out_of_range("Line edge is out of graph");
+            }
+
+            is_line_edge[edge_id] = true;
+            line_positions_[graph.GetEdge(edge_id).from].push_back({line, position});
+        }
+    }
+
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+
+        if (!is_line_edge[edge_id]) {
+            transfer_edges_[edge.from].push_back(edge_id);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename RaptorRouter<Weight>::RouteInfo> RaptorRouter<Weight>::BuildRoute(VertexId from,
+                                                                                         VertexId to) const {
+    return std::move(BuildRoutes(from, {to}).front());
+}
+
+template <typename Weight>
+std::vector<std::optional<typename RaptorRouter<Weight>::RouteInfo>>
+RaptorRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    const SearchResult result = Search(from, targets);
+
+    std::vector<std::optional<RouteInfo>> routes;
+    routes.reserve(targets.size());
+
+    for (const VertexId to : targets) {
+        if (!result.weights[to]) {
+            routes.push_back(std::nullopt);
+            continue;
+        }
+
+        //Путь восстанавливается с конца по меткам раундов
+        std::vector<const Edge<Weight>*> edges;
+        VertexId vertex = to;
+        size_t round = result.rounds_of_weights[to];
+
+        while (true) {
+            const Label& label = result.rounds[round][vertex];
+
+            if (label.transfer_edge != NO_EDGE) {
+                const auto& edge = graph_.GetEdge(label.transfer_edge);
+                edges.push_back(&edge);
+                vertex = edge.from;
+            } else if (label.line != NO_POSITION) {
+                const auto& line = lines_[label.line];
+                for (size_t position = label.alight + 1; position-- > label.board;) {
+                    edges.push_back(&graph_.GetEdge(line[position]));
+                }
+                vertex = graph_.GetEdge(line[label.board]).from;
+            } else {
+                break;
+            }
+            round = label.prev_round;
+        }
+
+        std::reverse(edges.begin(), edges.end());
+        routes.push_back(RouteInfo{*result.weights[to], std::move(edges)});
+    }
+
+    return routes;
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> RaptorRouter<Weight>::ComputeRouteWeights(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    const SearchResult result = Search(from, targets);
+
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(targets.size());
+
+    for (const VertexId to : targets) {
+        weights.push_back(result.weights[to]);
+    }
+
+    return weights;
+}
+
+template <typename Weight>
+typename RaptorRouter<Weight>::SearchResult RaptorRouter<Weight>::Search(VertexId from,
+                                                                         const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || std::any_of(targets.begin(), targets.end(), [vertex_count](VertexId to) {
+            return to >= vertex_count;
+        })) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    SearchResult result;
+    result.weights.resize(vertex_count);
+    result.rounds_of_weights.resize(vertex_count);
+
+    //Пути, не короче уже найденных до всех целей, ни одной цели не улучшат
+    auto compute_bound = [&result, &targets]() -> std::optional<Weight> {
+        std::optional<Weight> bound;
+        for (const VertexId to : targets) {
+            if (!result.weights[to]) {
+                return std::nullopt;
+            }
+            bound = bound ? std::max(*bound, *result.weights[to]) : *result.weights[to];
+        }
+        return bound;
+    };
+
+    //Раунд 0 - без поездок: начальная вершина и пересадки из нее
+    result.rounds.emplace_back(vertex_count);
+    result.rounds[0][from].weight = ZERO_WEIGHT;
+    result.weights[from] = ZERO_WEIGHT;
+
+    std::vector<VertexId> marked{from};
+    RelaxTransfers(marked, compute_bound(), result);
+
+    while (!marked.empty()) {
+        result.rounds.emplace_back(vertex_count);
+        marked = ScanLines(marked, compute_bound(), result);
+        RelaxTransfers(marked, compute_bound(), result);
+    }
+
+    return result;
+}
+
+template <typename Weight>
+std::vector<VertexId> RaptorRouter<Weight>::ScanLines(const std::vector<VertexId>& marked,
+                                                      std::optional<Weight> bound, SearchResult& result) const {
+    const size_t round = result.rounds.size() - 1;
+    auto& labels = result.rounds[round];
+
+    //Каждая линия просматривается один раз, с самой ранней позиции, где на нее можно сесть
+    std::vector<size_t> first_positions(lines_.size(), NO_POSITION);
+    std::vector<size_t> touched_lines;
+    for (const VertexId vertex : marked) {
+        for (const auto& [line, position] : line_positions_[vertex]) {
+            if (first_positions[line] == NO_POSITION) {
+                touched_lines.push_back(line);
+            }
+            first_positions[line] = std::min(first_positions[line], position);
+        }
+    }
+    std::sort(touched_lines.begin(), touched_lines.end());
+
+    std::vector<VertexId> improved;
+    for (const size_t line : touched_lines) {
+        const auto& edge_ids = lines_[line];
+
+        //Вес пути до места посадки и вес поездки считаются отдельно: вес поездки накапливается
+        //от посадки по перегонам, в том же порядке, что и вес ребра-поездки в полном графе
+        std::optional<Weight> board_weight;
+        Weight ride_weight = ZERO_WEIGHT;
+        size_t board = 0;
+        size_t board_round = 0;
+
+        for (size_t position = first_positions[line]; position < edge_ids.size(); ++position) {
+            const auto& edge = graph_.GetEdge(edge_ids[position]);
+
+            //Веса в result.weights пока из прошлых раундов: улучшения этого раунда записываются после
+            const auto& weight_from = result.weights[edge.from];
+            if (weight_from && (!board_weight || *weight_from < *board_weight + ride_weight)) {
+                board_weight = *weight_from;
+                ride_weight = ZERO_WEIGHT;
+                board = position;
+                board_round = result.rounds_of_weights[edge.from];
+            }
+
+            if (!board_weight) {
+                continue;
+            }
+
+            ride_weight += edge.weight;
+            const Weight candidate_weight = *board_weight + ride_weight;
+            auto& label = labels[edge.to];
+
+            if ((bound && !(candidate_weight < *bound))
+                || (result.weights[edge.to] && !(candidate_weight < *result.weights[edge.to]))
+                || (label.weight && !(candidate_weight < *label.weight))) {
+                continue;
+            }
+
+            if (!label.weight) {
+                improved.push_back(edge.to);
+            }
+            label = Label{candidate_weight, NO_EDGE, line, board, position, board_round};
+        }
+    }
+
+    for (const VertexId vertex : improved) {
+        result.weights[vertex] = labels[vertex].weight;
+        result.rounds_of_weights[vertex] = round;
+    }
+
+    return improved;
+}
+
+template <typename Weight>
+void RaptorRouter<Weight>::RelaxTransfers(std::vector<VertexId>& marked, std::optional<Weight> bound,
+                                          SearchResult& result) const {
+    const size_t round = result.rounds.size() - 1;
+    auto& labels = result.rounds[round];
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    for (const VertexId vertex : marked) {
+        queue.push({*result.weights[vertex], vertex});
+    }
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        if (*result.weights[vertex] < weight) {
+            continue;
+        }
+
+        for (const EdgeId edge_id : transfer_edges_[vertex]) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weight + edge.weight;
+
+            if ((bound && !(candidate_weight < *bound))
+                || (result.weights[edge.to] && !(candidate_weight < *result.weights[edge.to]))) {
+                continue;
+            }
+
+            if (!labels[edge.to].weight) {
+                marked.push_back(edge.to);
+            }
+            labels[edge.to] = Label{candidate_weight, edge_id, NO_POSITION, 0, 0, round};
+            result.weights[edge.to] = candidate_weight;
+            result.rounds_of_weights[edge.to] = round;
+            queue.push({candidate_weight, edge.to});
+        }
+    }
+}
+
+template <typename Weight>
+size_t RaptorRouter<Weight>::GetMemoryFootprint() const {
+    size_t footprint = lines_.capacity() * sizeof(std::vector<EdgeId>)
+                       + line_positions_.capacity() * sizeof(std::vector<LinePosition>)
+                       + transfer_edges_.capacity() * sizeof(std::vector<EdgeId>);
+
+    for (const auto& line : lines_) {
+        footprint += line.capacity() * sizeof(EdgeId);
+    }
+    for (const auto& positions : line_positions_) {
+        footprint += positions.capacity() * sizeof(LinePosition);
+    }
+    for (const auto& edge_ids : transfer_edges_) {
+        footprint += edge_ids.capacity() * sizeof(EdgeId);
+    }
+
+    return footprint;
+}
+}  // namespace graph
@@ -4,7 +4,6 @@ using namespace domain;
 
 
 using std::string_view;
-using std::set;
 
 std::optional<BusInfo> RequestHandler::GetBusInfo(string_view bus) const {
     auto bus_info = db_.FindBus(bus);
@@ -13,28 +12,24 @@ std::optional<BusInfo> RequestHandler::GetBusInfo(string_view bus) const {
         return std::nullopt;
     }
 
-    int stop_count = static_cast<int>(bus_info->stops_for_bus.size());
-    int unique_stops = db_.ComputeUniqueStops(*bus_info);
-    RouteDistanceInfo route_info = db_.ComputeRouteDistanceInfo(*bus_info);
-
-    return BusInfo{bus, stop_count, unique_stops, route_info};
+    return db_.GetBusInfo(*bus_info);
 }
 
-std::optional<set<string_view>> RequestHandler::GetStopInfo(string_view stop) const {
-    bool check_stop_in_catalogue = db_.FindStop(stop);
+std::optional<TransportCatalogue::BusNamesRange> RequestHandler::GetStopInfo(string_view stop) const {
+    const Stop* stop_info = db_.FindStop(stop);
 
-    if(!check_stop_in_catalogue) {
+    if(!stop_info) {
         return std::nullopt;
     }
 
-    return db_.FindBusesForStop(stop);
+    return db_.FindBusesForStop(stop_info->id);
 }
 
 svg::Document RequestHandler::RenderMap() const {
     return renderer_.CreateDocSVG(db_.GetBuses(false), db_.GetStops(false));  
 }
 
-std::optional<graph::Router<double>::RouteInfo> RequestHandler::BuildOptimasedRoute(const string_view stop_from, 
+std::optional<graph::RouterEngine<double>::RouteInfo> RequestHandler::BuildOptimasedRoute(const string_view stop_from, 
                                                                                     const string_view stop_to) const {
     return tr_.BuildOptimazedRoute(stop_from, stop_to);
 }
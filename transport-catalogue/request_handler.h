@@ -7,7 +7,6 @@
 #include "transport_router.h"
 
 #include <optional>
-#include <set>
 #include <string_view>
 
 class RequestHandler {
@@ -19,10 +18,10 @@ public:
     }
 
     std::optional<domain::BusInfo> GetBusInfo(std::string_view bus) const;
-    std::optional<std::set<std::string_view>> GetStopInfo(std::string_view stop) const;
+    std::optional<TransportCatalogue::BusNamesRange> GetStopInfo(std::string_view stop) const;
 
     svg::Document RenderMap() const;
-    std::optional<graph::Router<double>::RouteInfo> BuildOptimasedRoute(const std::string_view stop_from, 
+    std::optional<graph::RouterEngine<double>::RouteInfo> BuildOptimasedRoute(const std::string_view stop_from, 
                                                                         const std::string_view stop_to) const;
     
 
@@ -1,123 +1,734 @@
 #pragma once
 
 #include "graph.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+//Общий интерфейс движков поиска кратчайшего маршрута в графе
 template <typename Weight>
-class Router {
-private:
-    using Graph = DirectedWeightedGraph<Weight>;
-
+class RouterEngine {
 public:
-    explicit Router(const Graph& graph);
-
     struct RouteInfo {
         Weight weight;
         std::vector<const Edge<Weight>*> edges;
     };
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    //Маршруты из from в каждую вершину targets, в том же порядке.
+    //По умолчанию - отдельный BuildRoute на каждую цель
+    virtual std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                              const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<RouteInfo>> routes;
+        routes.reserve(targets.size());
+
+        for (const VertexId to : targets) {
+            routes.push_back(BuildRoute(from, to));
+        }
+
+        return routes;
+    }
+
+    using WeightMatrix = std::vector<std::vector<std::optional<Weight>>>;
+
+    //Веса кратчайших маршрутов для всех пар sources x targets, без восстановления ребер.
+    //По умолчанию строки матрицы считаются независимо и параллельно, через ComputeRouteWeights
+    virtual WeightMatrix ComputeWeightMatrix(const std::vector<VertexId>& sources,
+                                             const std::vector<VertexId>& targets,
+                                             parallel::ThreadPool& thread_pool) const {
+        WeightMatrix matrix(sources.size());
+
+        thread_pool.ParallelFor(sources.size(), [this, &matrix, &sources, &targets](size_t i) {
+            matrix[i] = ComputeRouteWeights(sources[i], targets);
+        });
+
+        return matrix;
+    }
 
+    //Память в байтах, занятая данными движка (без самого графа)
+    virtual size_t GetMemoryFootprint() const = 0;
+
+    virtual ~RouterEngine() = default;
+
+protected:
+    //Веса маршрутов из from в каждую из targets. По умолчанию - через BuildRoutes
+    virtual std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from,
+                                                                   const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(targets.size());
+
+        for (const auto& route : BuildRoutes(from, targets)) {
+            weights.push_back(route ? std::optional<Weight>(route->weight) : std::nullopt);
+        }
+
+        return weights;
+    }
+};
+
+//Движок с предрасчетом таблицы маршрутов между всеми парами вершин (Флойд-Уоршелл).
+//Таблица хранится двумя плоскими массивами V*V: веса и 32-битные id последних ребер маршрутов,
+//отсутствие маршрута кодируется весом-бесконечностью. Таблица считается по блокам, независимые
+//блоки обрабатываются параллельно; результат совпадает с последовательным алгоритмом бит в бит.
+//TableWeight позволяет хранить веса компактнее (например, float вместо double): тогда маршрут
+//выбирается по округленным весам, а вес результата пересчитывается по ребрам в Weight
+template <typename Weight, typename TableWeight = Weight>
+class Router final : public RouterEngine<Weight> {
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    using Graph = DirectedWeightedGraph<Weight>;
 
-    void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    static_assert(std::numeric_limits<TableWeight>::has_infinity,
+                  "Route table weight type should have infinity to encode missing routes");
 
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
-                    throw std::domain_error("Edges' weights should be non-negative");
-                }
+public:
+    using typename RouterEngine<Weight>::RouteInfo;
+    using PrevEdge = uint32_t;
+    static constexpr PrevEdge NO_PREV_EDGE = std::numeric_limits<PrevEdge>::max();
 
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
-                }
-            }
+    //Таблица считается в потоках thread_pool, если граф достаточно велик.
+    //tolerance - допустимая относительная погрешность веса ребра при переводе в TableWeight
+    Router(const Graph& graph, parallel::ThreadPool& thread_pool, double tolerance = 0.);
+
+    //Использует готовую таблицу V*V, рассчитанную ранее для того же графа, без копирования.
+    //Память таблицы (например, отображенный в память файл) должна пережить Router
+    Router(const Graph& graph, const TableWeight* weights, const PrevEdge* prev_edges, double tolerance = 0.);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    size_t GetMemoryFootprint() const override;
+
+    //Таблица маршрутов: V*V весов и V*V id последних ребер по строкам вершин отправления
+    const TableWeight* GetTableWeights() const;
+    const PrevEdge* GetTablePrevEdges() const;
+
+    //Дочинивает таблицу после того, как ребра графа [first, old_last) заменены на [first, new_last),
+    //а id следующих ребер сдвинулись. is_kept[i] - ребро first + i осталось прежним: те же концы и вес.
+    //Заново по Дейкстре считаются только строки, чьи маршруты шли по замененному ребру, и строки,
+    //где новое ребро дает до своего конца маршрут не длиннее прежнего. Таблица из файла сначала копируется.
+    //Флойд-Уоршелл и Дейкстра выбирают разные маршруты из равных по весу, поэтому дочинка совпадает
+    //с расчетом заново бит в бит, только если кратчайшие маршруты единственны. false - в графе есть
+    //равные кратчайшие маршруты, таблица испорчена и нужен расчет заново
+    bool RepairReplacedEdges(EdgeId first, EdgeId old_last, EdgeId new_last, const std::vector<bool>& is_kept,
+                             parallel::ThreadPool& thread_pool);
+
+protected:
+    std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from,
+                                                           const std::vector<VertexId>& targets) const override;
+
+private:
+
+    static constexpr TableWeight NO_ROUTE = std::numeric_limits<TableWeight>::infinity();
+
+    //Сторона квадратного блока матрицы
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    //Меньшие графы считаются в одном потоке: накладные расходы на синхронизацию больше выигрыша
+    static constexpr size_t MIN_PARALLEL_VERTEX_COUNT = 4 * BLOCK_SIZE;
+
+    size_t Index(VertexId vertex_from, VertexId vertex_to) const {
+        return vertex_from * vertex_count_ + vertex_to;
+    }
+
+    TableWeight ConvertEdgeWeight(const Edge<Weight>& edge) const {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+
+        const TableWeight edge_weight = static_cast<TableWeight>(edge.weight);
+        if (!(std::abs(static_cast<Weight>(edge_weight) - edge.weight) <= tolerance_ * edge.weight)) {
+            throw std::domain_error("Edge weight does not fit route table precision");
         }
+
+        return edge_weight;
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
+    //Относительная точность сравнения весов маршрутов: суммы одних и тех же ребер, сложенных
+    //в разном порядке, расходятся на ошибки округления, которые растут с длиной маршрута
+    TableWeight GetTieTolerance() const {
+        return std::numeric_limits<TableWeight>::epsilon() * static_cast<TableWeight>(2 * (vertex_count_ + 32));
+    }
 
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    std::vector<TableWeight> ConvertEdgeWeights() const {
+        std::vector<TableWeight> edge_weights(graph_.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < edge_weights.size(); ++edge_id) {
+            edge_weights[edge_id] = ConvertEdgeWeight(graph_.GetEdge(edge_id));
         }
+        return edge_weights;
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+    //Строка from по Дейкстре: только веса, последние ребра выбирает SelectUniquePrevEdges
+    void ComputeRowWeights(VertexId from, const std::vector<TableWeight>& edge_weights);
 
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
+    //Ставит в строку from последние ребра маршрутов по ее кратчайшим весам.
+    //false - в какую-то вершину кратчайшим весом приходят два ребра (или ни одного из-за округления)
+    bool SelectUniquePrevEdges(VertexId from, const std::vector<TableWeight>& edge_weights);
 
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+    //Пересчитывает веса строки from по ее маршрутам в том порядке сложения, что и Флойд-Уоршелл.
+    //false - последние ребра строки зациклились из-за округления весов
+    bool SumRowWeights(VertexId from, const std::vector<TableWeight>& edge_weights);
 
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
-                }
+    //Вес маршрута по вершинам vertices[0..count] и весам его ребер route_weights[0..count).
+    //Флойд-Уоршелл находит единственный кратчайший маршрут на шаге его промежуточной вершины
+    //с наибольшим id и складывает веса двух половин маршрута, найденные раньше тем же способом
+    static TableWeight SumRouteWeight(const VertexId* vertices, const TableWeight* route_weights, size_t count) {
+        if (count == 1) {
+            return route_weights[0];
+        }
+
+        const size_t middle = std::max_element(vertices + 1, vertices + count) - vertices;
+        return SumRouteWeight(vertices, route_weights, middle)
+               + SumRouteWeight(vertices + middle, route_weights + middle, count - middle);
+    }
+
+    //Обходит ребра маршрута from -> to с конца. Таблица из файла индекса при загрузке целиком
+    //не проверяется, поэтому здесь каждое ребро должно быть в графе и вести в текущую вершину,
+    //а маршрут - быть не длиннее числа вершин
+    template <typename Visit>
+    void ForEachRouteEdgeBackward(VertexId from, VertexId to, Visit visit) const {
+        size_t route_size = 0;
+        for (PrevEdge edge_id = table_prev_edges_[Index(from, to)];
+             edge_id != NO_PREV_EDGE;
+             edge_id = table_prev_edges_[Index(from, to)]) {
+
+            if (edge_id >= graph_.GetEdgeCount() || graph_.GetEdge(edge_id).to != to
+                || ++route_size > vertex_count_) {
+                throw std::out_of_range("Route table does not match the graph");
+            }
+
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            visit(edge);
+            to = edge.from;
+        }
+    }
+
+    //Кладет ребро в ячейку таблицы, если оно короче текущего маршрута
+    void RelaxEdge(EdgeId edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        const TableWeight edge_weight = ConvertEdgeWeight(edge);
+
+        const size_t index = Index(edge.from, edge.to);
+        if (weights_[index] > edge_weight) {
+            weights_[index] = edge_weight;
+            prev_edges_[index] = static_cast<PrevEdge>(edge_id);
+        }
+    }
+
+    void InitializeRoutesInternalData(const Graph& graph) {
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[Index(vertex, vertex)] = TableWeight{};
+
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                RelaxEdge(edge_id);
             }
         }
     }
 
+    //Релаксирует ячейки [0, count) строки через промежуточную вершину: weight_from/prev_from -
+    //маршрут до нее, weights_to/prev_edges_to - ее маршруты до ячеек строки.
+    //Отсутствующий маршрут до ячейки имеет вес NO_ROUTE, и сумма с ним никогда не меньше текущей
+    static void RelaxRow(TableWeight* weights, PrevEdge* prev_edges, size_t count,
+                         TableWeight weight_from, PrevEdge prev_from,
+                         const TableWeight* weights_to, const PrevEdge* prev_edges_to) {
+        //Цикл без ветвлений, чтобы компилятор мог его векторизовать
+        for (size_t i = 0; i < count; ++i) {
+            const TableWeight candidate_weight = weight_from + weights_to[i];
+            const bool is_shorter = candidate_weight < weights[i];
+            const PrevEdge candidate_prev = prev_edges_to[i] != NO_PREV_EDGE ? prev_edges_to[i] : prev_from;
+
+            weights[i] = is_shorter ? candidate_weight : weights[i];
+            prev_edges[i] = is_shorter ? candidate_prev : prev_edges[i];
+        }
+    }
+
+    //Шаг vertex_through не меняет ни строку, ни столбец vertex_through (веса неотрицательны),
+    //поэтому ячейке (from, to) на этом шаге нужны лишь значения (from, through) и (through, to),
+    //какими они были к началу шага. Блочная схема запоминает их для всего блока промежуточных
+    //вершин и дальше обрабатывает ячейки в любом порядке, сохраняя для каждой ячейки порядок шагов:
+    //  1. блок промежуточных вершин на пересечении своих строк и столбцов - последовательно;
+    //  2. строки блока в остальных столбцах - параллельно по блокам столбцов;
+    //  3. остальные строки - параллельно по блокам строк
+    void RelaxRoutesInternalDataThroughBlock(VertexId block_begin, parallel::ThreadPool* thread_pool);
+
+    void RelaxRowsOutsideBlock(VertexId row_begin, VertexId row_end, VertexId block_begin, VertexId block_end);
+
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    size_t vertex_count_;
+    double tolerance_;
+    bool has_unique_routes_ = false;  //Проверено, что все кратчайшие маршруты таблицы единственны
+    std::vector<TableWeight> weights_;
+    std::vector<PrevEdge> prev_edges_;
+
+    //Таблица, по которой отвечают запросы: собственная либо переданная в конструктор
+    const TableWeight* table_weights_ = nullptr;
+    const PrevEdge* table_prev_edges_ = nullptr;
+
+    //Строки блока промежуточных вершин: строка k - на момент начала шага block_begin + k
+    std::vector<TableWeight> snapshot_weights_;
+    std::vector<PrevEdge> snapshot_prev_edges_;
+    //Столбцы блока промежуточных вершин для строк блока на момент начала соответствующего шага
+    std::vector<TableWeight> block_weights_from_;
+    std::vector<PrevEdge> block_prev_edges_from_;
 };
 
-template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+template <typename Weight, typename TableWeight>
+Router<Weight, TableWeight>::Router(const Graph& graph, parallel::ThreadPool& thread_pool, double tolerance)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount())) {
+    , vertex_count_(graph.GetVertexCount())
+    , tolerance_(tolerance)
+    , weights_(vertex_count_ * vertex_count_, NO_ROUTE)
+    , prev_edges_(vertex_count_ * vertex_count_, NO_PREV_EDGE) {
+    if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+        throw std::length_error("Too many edges for route table");
+    }
+
     InitializeRoutesInternalData(graph);
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    parallel::ThreadPool* block_thread_pool = vertex_count_ >= MIN_PARALLEL_VERTEX_COUNT ? &thread_pool : nullptr;
+    for (VertexId block_begin = 0; block_begin < vertex_count_; block_begin += BLOCK_SIZE) {
+        RelaxRoutesInternalDataThroughBlock(block_begin, block_thread_pool);
     }
+
+    snapshot_weights_ = {};
+    snapshot_prev_edges_ = {};
+    block_weights_from_ = {};
+    block_prev_edges_from_ = {};
+
+    table_weights_ = weights_.data();
+    table_prev_edges_ = prev_edges_.data();
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
-        return std::nullopt;
+template <typename Weight, typename TableWeight>
+Router<Weight, TableWeight>::Router(const Graph& graph, const TableWeight* weights, const PrevEdge* prev_edges,
+                                    double tolerance)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , tolerance_(tolerance)
+    , table_weights_(weights)
+    , table_prev_edges_(prev_edges) {
+}
+
+template <typename Weight, typename TableWeight>
+void Router<Weight, TableWeight>::ComputeRowWeights(VertexId from, const std::vector<TableWeight>& edge_weights) {
+    TableWeight* weights = &weights_[Index(from, 0)];
+    std::fill(weights, weights + vertex_count_, NO_ROUTE);
+    weights[from] = TableWeight{};
+
+    using QueueItem = std::pair<TableWeight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    queue.push({weights[from], from});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const VertexId to = graph_.GetEdge(edge_id).to;
+            const TableWeight candidate_weight = weight + edge_weights[edge_id];
+            if (candidate_weight < weights[to]) {
+                weights[to] = candidate_weight;
+                queue.push({candidate_weight, to});
+            }
+        }
     }
+}
 
-    const Weight weight = route_internal_data->weight;
-    std::vector<const Edge<Weight>* > edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
+template <typename Weight, typename TableWeight>
+bool Router<Weight, TableWeight>::SelectUniquePrevEdges(VertexId from, const std::vector<TableWeight>& edge_weights) {
+    const TableWeight* weights = &weights_[Index(from, 0)];
+    PrevEdge* prev_edges = &prev_edges_[Index(from, 0)];
+    const TableWeight tie_tolerance = GetTieTolerance();
 
-        edges.push_back(&graph_.GetEdge(*edge_id));
+    std::fill(prev_edges, prev_edges + vertex_count_, NO_PREV_EDGE);
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.to == from || weights[edge.from] == NO_ROUTE
+            || weights[edge.from] + edge_weights[edge_id] > weights[edge.to] * (1 + tie_tolerance)) {
+            continue;
+        }
+        if (prev_edges[edge.to] != NO_PREV_EDGE) {
+            return false;
+        }
+        prev_edges[edge.to] = static_cast<PrevEdge>(edge_id);
     }
+
+    for (VertexId to = 0; to < vertex_count_; ++to) {
+        if (to != from && weights[to] != NO_ROUTE && prev_edges[to] == NO_PREV_EDGE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Weight, typename TableWeight>
+bool Router<Weight, TableWeight>::SumRowWeights(VertexId from, const std::vector<TableWeight>& edge_weights) {
+    TableWeight* weights = &weights_[Index(from, 0)];
+    const PrevEdge* prev_edges = &prev_edges_[Index(from, 0)];
+
+    //Маршрут собирается с конца, затем разворачивается
+    std::vector<VertexId> vertices;
+    std::vector<TableWeight> route_weights;
+    for (VertexId to = 0; to < vertex_count_; ++to) {
+        if (prev_edges[to] == NO_PREV_EDGE) {
+            continue;
+        }
+
+        vertices.assign(1, to);
+        route_weights.clear();
+        for (VertexId vertex = to; vertex != from;) {
+            if (route_weights.size() == vertex_count_) {
+                return false;
+            }
+            const EdgeId edge_id = prev_edges[vertex];
+            route_weights.push_back(edge_weights[edge_id]);
+            vertex = graph_.GetEdge(edge_id).from;
+            vertices.push_back(vertex);
+        }
+        std::reverse(vertices.begin(), vertices.end());
+        std::reverse(route_weights.begin(), route_weights.end());
+
+        weights[to] = SumRouteWeight(vertices.data(), route_weights.data(), route_weights.size());
+    }
+    return true;
+}
+
+template <typename Weight, typename TableWeight>
+bool Router<Weight, TableWeight>::RepairReplacedEdges(EdgeId first, EdgeId old_last, EdgeId new_last,
+                                                      const std::vector<bool>& is_kept,
+                                                      parallel::ThreadPool& thread_pool) {
+    if (graph_.GetEdgeCount() >= NO_PREV_EDGE) {
+        throw std::length_error("Too many edges for route table");
+    }
+
+    //Таблицу из файла индекса дальше меняем в собственной копии
+    if (weights_.empty()) {
+        weights_.assign(table_weights_, table_weights_ + vertex_count_ * vertex_count_);
+        prev_edges_.assign(table_prev_edges_, table_prev_edges_ + vertex_count_ * vertex_count_);
+        table_weights_ = weights_.data();
+        table_prev_edges_ = prev_edges_.data();
+    }
+
+    auto is_kept_edge = [first, &is_kept](EdgeId edge_id) {
+        return edge_id - first < is_kept.size() && is_kept[edge_id - first];
+    };
+
+    const std::vector<TableWeight> edge_weights = ConvertEdgeWeights();
+    const TableWeight tie_tolerance = GetTieTolerance();
+    std::vector<EdgeId> added_edges;
+    for (EdgeId edge_id = first; edge_id < new_last; ++edge_id) {
+        if (!is_kept_edge(edge_id)) {
+            added_edges.push_back(edge_id);
+        }
+    }
+
+    //Строка остается прежней, если ее маршруты не идут по удаленным ребрам, а добавленные ребра
+    //не дают маршрута до своего конца не длиннее прежнего: тогда и все ее маршруты обходятся без них.
+    //Флаги - char, а не bool, чтобы потоки писали в разные байты
+    std::vector<char> is_affected(vertex_count_, false);
+    auto check_row = [&](size_t row) {
+        bool is_row_affected = false;
+
+        //Id ребер после замененных сдвигаются, а замененные ребра - повод пересчитать строку
+        PrevEdge* prev_edges = &prev_edges_[Index(row, 0)];
+        for (VertexId to = 0; to < vertex_count_; ++to) {
+            const PrevEdge prev_edge = prev_edges[to];
+            if (prev_edge == NO_PREV_EDGE || prev_edge < first) {
+                continue;
+            }
+            if (prev_edge >= old_last) {
+                prev_edges[to] = static_cast<PrevEdge>(prev_edge - old_last + new_last);
+            } else if (!is_kept_edge(prev_edge)) {
+                is_row_affected = true;
+            }
+        }
+
+        for (const EdgeId edge_id : added_edges) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const TableWeight weight_from = weights_[Index(row, edge.from)];
+            if (weight_from != NO_ROUTE
+                && weight_from + edge_weights[edge_id] <= weights_[Index(row, edge.to)] * (1 + tie_tolerance)) {
+                is_row_affected = true;
+                break;
+            }
+        }
+
+        is_affected[row] = is_row_affected;
+    };
+
+    parallel::ThreadPool* row_thread_pool = vertex_count_ >= MIN_PARALLEL_VERTEX_COUNT ? &thread_pool : nullptr;
+    if (row_thread_pool) {
+        row_thread_pool->ParallelFor(vertex_count_, check_row);
+    } else {
+        for (VertexId row = 0; row < vertex_count_; ++row) {
+            check_row(row);
+        }
+    }
+
+    //Нетронутая строка таблицы без равных маршрутов и после замены ребер их не получает, а ее веса
+    //уже сложены, как у Флойда-Уоршелла. Поэтому единственность проверяется и веса складываются заново
+    //у пересчитанных строк, а у остальных - только при первой дочинке.
+    //Проверка идет по всем строкам, даже если равные маршруты уже найдены: потоки не прерываются
+    std::vector<VertexId> rows;
+    for (VertexId row = 0; row < vertex_count_; ++row) {
+        if (is_affected[row] || !has_unique_routes_) {
+            rows.push_back(row);
+        }
+    }
+
+    std::vector<char> is_unique(rows.size(), false);
+    auto repair_row = [&](size_t i) {
+        if (is_affected[rows[i]]) {
+            ComputeRowWeights(rows[i], edge_weights);
+        }
+        is_unique[i] = SelectUniquePrevEdges(rows[i], edge_weights) && SumRowWeights(rows[i], edge_weights);
+    };
+
+    if (row_thread_pool) {
+        row_thread_pool->ParallelFor(rows.size(), repair_row);
+    } else {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            repair_row(i);
+        }
+    }
+
+    has_unique_routes_ = std::all_of(is_unique.begin(), is_unique.end(), [](char unique) { return unique; });
+    return has_unique_routes_;
+}
+
+template <typename Weight, typename TableWeight>
+void Router<Weight, TableWeight>::RelaxRoutesInternalDataThroughBlock(VertexId block_begin,
+                                                                      parallel::ThreadPool* thread_pool) {
+    const VertexId block_end = std::min(block_begin + BLOCK_SIZE, vertex_count_);
+    const size_t block_size = block_end - block_begin;
+
+    snapshot_weights_.resize(block_size * vertex_count_);
+    snapshot_prev_edges_.resize(block_size * vertex_count_);
+    block_weights_from_.resize(block_size * block_size);
+    block_prev_edges_from_.resize(block_size * block_size);
+
+    //Копирует ячейки [column_begin, column_end) строки through в снимок
+    auto take_snapshot = [this, block_begin](VertexId through, VertexId column_begin, VertexId column_end) {
+        const size_t snapshot_index = (through - block_begin) * vertex_count_ + column_begin;
+        std::copy(weights_.begin() + Index(through, column_begin), weights_.begin() + Index(through, column_end),
+                  snapshot_weights_.begin() + snapshot_index);
+        std::copy(prev_edges_.begin() + Index(through, column_begin), prev_edges_.begin() + Index(through, column_end),
+                  snapshot_prev_edges_.begin() + snapshot_index);
+    };
+
+    //Релаксирует строки блока в столбцах [column_begin, column_end) через все вершины блока
+    auto relax_block_rows = [this, block_begin, block_end, block_size, &take_snapshot](VertexId column_begin,
+                                                                                        VertexId column_end) {
+        for (VertexId through = block_begin; through < block_end; ++through) {
+            const size_t through_index = through - block_begin;
+            take_snapshot(through, column_begin, column_end);
+
+            for (VertexId row = block_begin; row < block_end; ++row) {
+                const size_t from_index = (row - block_begin) * block_size + through_index;
+                if (block_weights_from_[from_index] == NO_ROUTE) {
+                    continue;
+                }
+
+                const size_t snapshot_index = through_index * vertex_count_ + column_begin;
+                RelaxRow(&weights_[Index(row, column_begin)], &prev_edges_[Index(row, column_begin)],
+                         column_end - column_begin,
+                         block_weights_from_[from_index], block_prev_edges_from_[from_index],
+                         &snapshot_weights_[snapshot_index], &snapshot_prev_edges_[snapshot_index]);
+            }
+        }
+    };
+
+    //1. Пересечение строк и столбцов блока - обычный Флойд-Уоршелл.
+    //Попутно запоминаются значения (row, through) к началу шага through
+    for (VertexId through = block_begin; through < block_end; ++through) {
+        const size_t through_index = through - block_begin;
+        take_snapshot(through, block_begin, block_end);
+
+        for (VertexId row = block_begin; row < block_end; ++row) {
+            const size_t from_index = (row - block_begin) * block_size + through_index;
+
+            block_weights_from_[from_index] = weights_[Index(row, through)];
+            block_prev_edges_from_[from_index] = prev_edges_[Index(row, through)];
+            if (block_weights_from_[from_index] == NO_ROUTE) {
+                continue;
+            }
+
+            const size_t snapshot_index = through_index * vertex_count_ + block_begin;
+            RelaxRow(&weights_[Index(row, block_begin)], &prev_edges_[Index(row, block_begin)], block_size,
+                     block_weights_from_[from_index], block_prev_edges_from_[from_index],
+                     &snapshot_weights_[snapshot_index], &snapshot_prev_edges_[snapshot_index]);
+        }
+    }
+
+    //2. Строки блока в остальных столбцах: каждый блок столбцов независим
+    const size_t column_block_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    auto relax_column_block = [this, block_begin, &relax_block_rows](size_t column_block) {
+        const VertexId column_begin = column_block * BLOCK_SIZE;
+        if (column_begin != block_begin) {
+            relax_block_rows(column_begin, std::min(column_begin + BLOCK_SIZE, vertex_count_));
+        }
+    };
+
+    //3. Остальные строки: каждый блок строк независим
+    auto relax_row_block = [this, block_begin, block_end](size_t row_block) {
+        const VertexId row_begin = row_block * BLOCK_SIZE;
+        if (row_begin != block_begin) {
+            RelaxRowsOutsideBlock(row_begin, std::min(row_begin + BLOCK_SIZE, vertex_count_), block_begin, block_end);
+        }
+    };
+
+    if (thread_pool) {
+        thread_pool->ParallelFor(column_block_count, relax_column_block);
+        thread_pool->ParallelFor(column_block_count, relax_row_block);
+    } else {
+        for (size_t column_block = 0; column_block < column_block_count; ++column_block) {
+            relax_column_block(column_block);
+        }
+        for (size_t row_block = 0; row_block < column_block_count; ++row_block) {
+            relax_row_block(row_block);
+        }
+    }
+}
+
+template <typename Weight, typename TableWeight>
+void Router<Weight, TableWeight>::RelaxRowsOutsideBlock(VertexId row_begin, VertexId row_end,
+                                                        VertexId block_begin, VertexId block_end) {
+    const size_t block_size = block_end - block_begin;
+    std::vector<TableWeight> weights_from((row_end - row_begin) * block_size);
+    std::vector<PrevEdge> prev_edges_from((row_end - row_begin) * block_size);
+
+    //Сначала столбцы самого блока: по ходу запоминаем значения (row, through) к началу шага through
+    for (VertexId row = row_begin; row < row_end; ++row) {
+        for (VertexId through = block_begin; through < block_end; ++through) {
+            const size_t through_index = through - block_begin;
+            const size_t from_index = (row - row_begin) * block_size + through_index;
+
+            weights_from[from_index] = weights_[Index(row, through)];
+            prev_edges_from[from_index] = prev_edges_[Index(row, through)];
+            if (weights_from[from_index] == NO_ROUTE) {
+                continue;
+            }
+
+            const size_t snapshot_index = through_index * vertex_count_ + block_begin;
+            RelaxRow(&weights_[Index(row, block_begin)], &prev_edges_[Index(row, block_begin)], block_size,
+                     weights_from[from_index], prev_edges_from[from_index],
+                     &snapshot_weights_[snapshot_index], &snapshot_prev_edges_[snapshot_index]);
+        }
+    }
+
+    //Затем остальные столбцы поблочно, чтобы блок снимка оставался в кэше для всех строк
+    for (VertexId column_begin = 0; column_begin < vertex_count_; column_begin += BLOCK_SIZE) {
+        if (column_begin == block_begin) {
+            continue;
+        }
+        const size_t column_count = std::min(column_begin + BLOCK_SIZE, vertex_count_) - column_begin;
+
+        for (VertexId row = row_begin; row < row_end; ++row) {
+            for (size_t through_index = 0; through_index < block_size; ++through_index) {
+                const size_t from_index = (row - row_begin) * block_size + through_index;
+                if (weights_from[from_index] == NO_ROUTE) {
+                    continue;
+                }
+
+                const size_t snapshot_index = through_index * vertex_count_ + column_begin;
+                RelaxRow(&weights_[Index(row, column_begin)], &prev_edges_[Index(row, column_begin)], column_count,
+                         weights_from[from_index], prev_edges_from[from_index],
+                         &snapshot_weights_[snapshot_index], &snapshot_prev_edges_[snapshot_index]);
+            }
+        }
+    }
+}
+
+template <typename Weight, typename TableWeight>
+std::optional<typename Router<Weight, TableWeight>::RouteInfo>
+Router<Weight, TableWeight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    if (table_weights_[Index(from, to)] == NO_ROUTE) {
+        return std::nullopt;
+    }
+
+    //Для TableWeight, отличного от Weight, точный вес - сумма весов ребер в порядке обхода с конца
+    Weight weight = ZERO_WEIGHT;
+    std::vector<const Edge<Weight>* > edges;
+    ForEachRouteEdgeBackward(from, to, [&weight, &edges](const Edge<Weight>& edge) {
+        edges.push_back(&edge);
+        if constexpr (!std::is_same_v<Weight, TableWeight>) {
+            weight += edge.weight;
+        }
+    });
     
     std::reverse(edges.begin(), edges.end());
 
-    return RouteInfo{weight, std::move(edges)};
+    if constexpr (std::is_same_v<Weight, TableWeight>) {
+        return RouteInfo{table_weights_[Index(from, to)], std::move(edges)};
+    } else {
+        return RouteInfo{weight, std::move(edges)};
+    }
+}
+
+template <typename Weight, typename TableWeight>
+std::vector<std::optional<Weight>> Router<Weight, TableWeight>::ComputeRouteWeights(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(targets.size());
+
+    for (const VertexId to : targets) {
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+
+        if (table_weights_[Index(from, to)] == NO_ROUTE) {
+            weights.push_back(std::nullopt);
+            continue;
+        }
+
+        if constexpr (std::is_same_v<Weight, TableWeight>) {
+            weights.push_back(table_weights_[Index(from, to)]);
+        } else {
+            //Как и в BuildRoute, веса ребер суммируются по ходу обхода с конца, без буфера
+            Weight weight = ZERO_WEIGHT;
+            ForEachRouteEdgeBackward(from, to, [&weight](const Edge<Weight>& edge) {
+                weight += edge.weight;
+            });
+            weights.push_back(weight);
+        }
+    }
+
+    return weights;
+}
+
+template <typename Weight, typename TableWeight>
+size_t Router<Weight, TableWeight>::GetMemoryFootprint() const {
+    //Для внешней таблицы учитываем ее размер: отображенный файл тоже занимает память процесса
+    return vertex_count_ * vertex_count_ * (sizeof(TableWeight) + sizeof(PrevEdge));
+}
+
+template <typename Weight, typename TableWeight>
+const TableWeight* Router<Weight, TableWeight>::GetTableWeights() const {
+    return table_weights_;
+}
+
+template <typename Weight, typename TableWeight>
+const typename Router<Weight, TableWeight>::PrevEdge* Router<Weight, TableWeight>::GetTablePrevEdges() const {
+    return table_prev_edges_;
 }
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "routing_index.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ROUTING_INDEX_HAS_MMAP
+#endif
+
+using namespace std::literals;
+
+namespace routing_index {
+//_____Checksum_____
+void Checksum::Add(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash_ ^= bytes[i];
+        hash_ *= 1099511628211ull;
+    }
+}
+
+void Checksum::Add(std::string_view str) {
+    //Длина отделяет соседние строки друг от друга: "ab" + "c" != "a" + "bc"
+    AddValue(static_cast<uint64_t>(str.size()));
+    Add(str.data(), str.size());
+}
+
+uint64_t Checksum::Get() const {
+    return hash_;
+}
+
+//_____MappedFile_____
+MappedFile::MappedFile(const std::string& path) {
+#ifdef ROUTING_INDEX_HAS_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+        if (data != MAP_FAILED) {
+            data_ = static_cast<const char*>(data);
+            size_ = static_cast<size_t>(file_stat.st_size);
+            is_mapped_ = true;
+        }
+    }
+    close(fd);
+#else
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return;
+    }
+
+    buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef ROUTING_INDEX_HAS_MMAP
+    if (is_mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+bool MappedFile::IsOpen() const {
+    return data_ != nullptr;
+}
+
+const char* MappedFile::GetData() const {
+    return data_;
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+const char* MappedFile::GetSection(const Section& section) const {
+    if (section.offset > size_ || section.size > size_ - section.offset) {
+        return nullptr;
+    }
+
+    return data_ + section.offset;
+}
+
+uint64_t ComputeSectionsChecksum(const char* data, std::initializer_list<Section> sections) {
+    Checksum checksum;
+    for (const Section& section : sections) {
+        checksum.Add(data + section.offset, section.size);
+    }
+    return checksum.Get();
+}
+
+bool VerifyTableChecksum(const MappedFile& file) {
+    if (!file.IsOpen() || file.GetSize() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.GetData(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION
+        || !file.GetSection(header.table_weights) || !file.GetSection(header.table_prev_edges)) {
+        return false;
+    }
+
+    return header.table_checksum
+           == ComputeSectionsChecksum(file.GetData(), {header.table_weights, header.table_prev_edges});
+}
+
+uint64_t ComputeTableRowChecksum(const void* weights_row, size_t weights_row_size,
+                                 const void* prev_edges_row, size_t prev_edges_row_size) {
+    Checksum checksum;
+    checksum.Add(weights_row, weights_row_size);
+    checksum.Add(prev_edges_row, prev_edges_row_size);
+    return checksum.Get();
+}
+
+//_____FileBuilder_____
+FileBuilder::FileBuilder()
+    : buffer_(sizeof(Header)) {
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    std::memcpy(buffer_.data(), &header, sizeof(Header));
+}
+
+FileBuilder::FileBuilder(size_t header_size)
+    : buffer_(header_size) {
+}
+
+Section FileBuilder::AddSection(const void* data, size_t size) {
+    const uint64_t offset = (buffer_.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    buffer_.resize(offset + size);
+
+    if (size != 0) {
+        std::memcpy(buffer_.data() + offset, data, size);
+    }
+
+    return Section{offset, size};
+}
+
+Header& FileBuilder::GetHeader() {
+    return GetHeaderAs<Header>();
+}
+
+const char* FileBuilder::GetData() const {
+    return buffer_.data();
+}
+
+size_t FileBuilder::GetSize() const {
+    return buffer_.size();
+}
+
+void FileBuilder::Write(const std::string& path) const {
+    const std::string tmp_path = path + ".tmp"s;
+
+    {
+        std::ofstream output(tmp_path, std::ios::binary | std::ios::trunc);
+        output.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+
+        if (!output) {
+            throw std::runtime_error("Failed to write "s + tmp_path);
+        }
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Failed to replace "s + path);
+    }
+}
+}  // namespace routing_index
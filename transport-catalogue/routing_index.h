@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Двоичный формат файла с предрасчитанным индексом маршрутизации.
+//Файл состоит из заголовка и секций, выровненных по SECTION_ALIGNMENT:
+//  строки   - имена остановок и маршрутов подряд, без разделителей;
+//  ребра    - EdgeRecord для каждого ребра графа в порядке EdgeId;
+//  вершины  - StopRecord для каждой остановки: имя и вершина начала ожидания;
+//  таблица  - веса и id последних ребер таблицы ALL_PAIRS;
+//  суммы строк - контрольная сумма каждой строки таблицы (ее весов и id последних ребер).
+//Индекс пишется только для движка ALL_PAIRS: состояние других движков в файл не попадает.
+//Все числа записаны в порядке байтов машины, на которой файл создан
+namespace routing_index {
+inline constexpr char MAGIC[8] = {'T', 'C', 'R', 'O', 'U', 'T', 'E', '\0'};
+inline constexpr uint32_t FORMAT_VERSION = 4;
+inline constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+struct Section {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version = FORMAT_VERSION;
+    uint32_t header_size = sizeof(Header);
+    uint64_t checksum = 0;       //Контрольная сумма справочника и настроек, по которым построен индекс
+    uint64_t graph_checksum = 0;  //Контрольная сумма секций строк, ребер и вершин
+    uint64_t table_checksum = 0;  //Контрольная сумма секций таблицы, см. VerifyTableChecksum
+
+    uint64_t vertex_count = 0;
+    uint32_t engine = 0;
+    uint32_t table_weight_size = 0;  //sizeof веса в таблице
+
+    Section strings;
+    Section edges;
+    Section stops;
+    Section table_weights;
+    Section table_prev_edges;
+    Section table_row_checksums;  //uint64_t на каждую вершину отправления
+};
+
+struct EdgeRecord {
+    uint64_t name_offset;
+    uint64_t name_size;
+    uint64_t span_count;
+    uint64_t from;
+    uint64_t to;
+    double weight;
+};
+
+struct StopRecord {
+    uint64_t name_offset;
+    uint64_t name_size;
+    uint64_t vertex;
+};
+
+//64-битный FNV-1a для контрольной суммы содержимого
+class Checksum {
+public:
+    void Add(const void* data, size_t size);
+    void Add(std::string_view str);
+
+    template <typename Value>
+    void AddValue(const Value& value) {
+        Add(&value, sizeof(value));
+    }
+
+    uint64_t Get() const;
+
+private:
+    uint64_t hash_ = 14695981039346656037ull;
+};
+
+//Файл, отображенный в память только для чтения. Там, где mmap недоступен, файл читается целиком
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const;
+    const char* GetData() const;
+    size_t GetSize() const;
+
+    //Возвращает указатель на секцию или nullptr, если секция выходит за пределы файла
+    const char* GetSection(const Section& section) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_mapped_ = false;
+    std::vector<char> buffer_;
+};
+
+//Контрольная сумма секций файла data подряд. Секции должны лежать в пределах файла
+uint64_t ComputeSectionsChecksum(const char* data, std::initializer_list<Section> sections);
+
+//Сверяет таблицу маршрутов файла индекса с ее контрольной суммой. Таблица занимает почти весь файл
+//(V*V ячеек), поэтому при загрузке индекса ее сумма проверяется только по запросу, а без него
+//каждая строка сверяется со своей суммой при первом обращении к ней
+bool VerifyTableChecksum(const MappedFile& file);
+
+//Контрольная сумма строки таблицы: ее весов и id последних ребер
+uint64_t ComputeTableRowChecksum(const void* weights_row, size_t weights_row_size,
+                                 const void* prev_edges_row, size_t prev_edges_row_size);
+
+//Пишет секции в буфер, выравнивая каждую по SECTION_ALIGNMENT
+class FileBuilder {
+public:
+    FileBuilder();  //С заголовком индекса маршрутизации
+    //С заголовком другого формата: header_size нулевых байт в начале файла, заполняются через GetHeaderAs
+    explicit FileBuilder(size_t header_size);
+
+    Section AddSection(const void* data, size_t size);
+    Header& GetHeader();
+
+    template <typename FileHeader>
+    FileHeader& GetHeaderAs() {
+        return *reinterpret_cast<FileHeader*>(buffer_.data());
+    }
+
+    const char* GetData() const;
+    size_t GetSize() const;
+
+    //Записывает файл через временный, чтобы читатели не увидели его недописанным
+    void Write(const std::string& path) const;
+
+private:
+    std::vector<char> buffer_;
+};
+}  // namespace routing_index
@@ -0,0 +1,199 @@
+#define _USE_MATH_DEFINES
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+namespace spatial_index {
+namespace {
+double SquaredChord(const double (&lhs)[3], const double (&rhs)[3]) {
+    double result = 0.;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double delta = lhs[axis] - rhs[axis];
+        result += delta * delta;
+    }
+    return result;
+}
+}  // namespace
+
+struct StopIndex::Query {
+    double point[3];
+    size_t count = 0;         //Для ближайших: сколько точек нужно
+    double max_chord2 = 0.;   //Для радиуса: квадрат наибольшей допустимой хорды
+    std::priority_queue<std::pair<double, size_t>> nearest;  //Худшая из найденных - наверху
+    std::vector<size_t> found;
+};
+
+StopIndex::StopIndex(const std::vector<const domain::Stop*>& stops) {
+    points_.reserve(stops.size());
+
+    for (const domain::Stop* stop : stops) {
+        Point point{};
+        geo::ToUnitVector(stop->coordinates, point.coordinates);
+        point.stop = stop;
+        points_.push_back(point);
+    }
+
+    Build(0, points_.size());
+}
+
+void StopIndex::Build(size_t first, size_t last) {
+    if (last - first <= 1) {
+        return;
+    }
+
+    //Делим по оси с наибольшим разбросом: остановки города занимают малый участок сферы
+    double min[3] = {2., 2., 2.};
+    double max[3] = {-2., -2., -2.};
+    for (size_t i = first; i < last; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], points_[i].coordinates[axis]);
+            max[axis] = std::max(max[axis], points_[i].coordinates[axis]);
+        }
+    }
+
+    uint8_t split_axis = 0;
+    for (uint8_t axis = 1; axis < 3; ++axis) {
+        if (max[axis] - min[axis] > max[split_axis] - min[split_axis]) {
+            split_axis = axis;
+        }
+    }
+
+    const size_t middle = first + (last - first) / 2;
+    std::nth_element(points_.begin() + first, points_.begin() + middle, points_.begin() + last,
+                     [split_axis](const Point& lhs, const Point& rhs) {
+                         return lhs.coordinates[split_axis] < rhs.coordinates[split_axis];
+                     });
+    points_[middle].axis = split_axis;
+
+    Build(first, middle);
+    Build(middle + 1, last);
+}
+
+std::vector<NearbyStop> StopIndex::FindNearest(geo::Coordinates point, size_t count) const {
+    Query query;
+    geo::ToUnitVector(point, query.point);
+    query.count = count;
+
+    if (count != 0) {
+        SearchNearest(0, points_.size(), query);
+    }
+
+    while (!query.nearest.empty()) {
+        query.found.push_back(query.nearest.top().second);
+        query.nearest.pop();
+    }
+
+    return MakeResult(point, query.found);
+}
+
+std::vector<NearbyStop> StopIndex::FindInRadius(geo::Coordinates point, double radius) const {
+    if (radius < 0) {
+        return {};
+    }
+
+    Query query;
+    geo::ToUnitVector(point, query.point);
+
+    //Хорда дуги angle - 2 sin(angle / 2). Запас на округление, лишнее отсеется точным расстоянием
+    const double angle = std::min(radius / geo::EARTH_RADIUS, M_PI);
+    const double max_chord = 2. * std::sin(angle / 2.);
+    query.max_chord2 = max_chord * max_chord * (1. + 1e-9) + 1e-15;
+
+    SearchInRadius(0, points_.size(), query);
+
+    auto result = MakeResult(point, query.found);
+    result.erase(std::find_if(result.begin(), result.end(),
+                              [radius](const NearbyStop& stop) {
+                                  return stop.distance > radius;
+                              }),
+                 result.end());
+    return result;
+}
+
+void StopIndex::SearchNearest(size_t first, size_t last, Query& query) const {
+    if (first >= last) {
+        return;
+    }
+
+    const size_t middle = first + (last - first) / 2;
+    const Point& point = points_[middle];
+
+    const double chord2 = SquaredChord(query.point, point.coordinates);
+    if (query.nearest.size() < query.count) {
+        query.nearest.push({chord2, middle});
+    } else if (chord2 < query.nearest.top().first) {
+        query.nearest.pop();
+        query.nearest.push({chord2, middle});
+    }
+
+    if (last - first == 1) {
+        return;
+    }
+
+    //Сначала половина, где лежит точка запроса, вторая - только если в ней может быть ближе
+    const double delta = query.point[point.axis] - point.coordinates[point.axis];
+    const bool left_first = delta < 0;
+
+    if (left_first) {
+        SearchNearest(first, middle, query);
+    } else {
+        SearchNearest(middle + 1, last, query);
+    }
+
+    if (query.nearest.size() < query.count || delta * delta < query.nearest.top().first) {
+        if (left_first) {
+            SearchNearest(middle + 1, last, query);
+        } else {
+            SearchNearest(first, middle, query);
+        }
+    }
+}
+
+void StopIndex::SearchInRadius(size_t first, size_t last, Query& query) const {
+    if (first >= last) {
+        return;
+    }
+
+    const size_t middle = first + (last - first) / 2;
+    const Point& point = points_[middle];
+
+    if (SquaredChord(query.point, point.coordinates) <= query.max_chord2) {
+        query.found.push_back(middle);
+    }
+
+    const double delta = query.point[point.axis] - point.coordinates[point.axis];
+    if (delta < 0 || delta * delta <= query.max_chord2) {
+        SearchInRadius(first, middle, query);
+    }
+    if (delta >= 0 || delta * delta <= query.max_chord2) {
+        SearchInRadius(middle + 1, last, query);
+    }
+}
+
+std::vector<NearbyStop> StopIndex::MakeResult(geo::Coordinates point, const std::vector<size_t>& found) const {
+    const geo::PreparedCoordinates prepared_point = geo::PrepareCoordinates(point);
+
+    std::vector<NearbyStop> result;
+    result.reserve(found.size());
+
+    for (const size_t index : found) {
+        const domain::Stop* stop = points_[index].stop;
+        const double distance = geo::ComputeDistance(prepared_point, stop->prepared_coordinates);
+        //Для совпадающих точек acos от округленного аргумента может дать NaN
+        result.push_back({stop, distance > 0 ? distance : 0.});
+    }
+
+    std::sort(result.begin(), result.end(), [](const NearbyStop& lhs, const NearbyStop& rhs) {
+        if (lhs.distance != rhs.distance) {
+            return lhs.distance < rhs.distance;
+        }
+        return lhs.stop->name_stop < rhs.stop->name_stop;
+    });
+
+    return result;
+}
+}  // namespace spatial_index
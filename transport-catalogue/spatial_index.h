@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+
+namespace spatial_index {
+
+struct NearbyStop {
+    const domain::Stop* stop;
+    double distance;  //Метры по сфере, как у geo::ComputeDistance
+};
+
+//k-d дерево над остановками. Точки лежат на единичной сфере в трехмерных координатах: длина
+//хорды монотонна по расстоянию по сфере, поэтому ближайшие по хорде - ближайшие и по сфере,
+//а нет проблем со швом долготы 180 и с полюсами. Построение O(n log n), запрос O(log n + k).
+//Указатели на остановки должны жить, пока используется индекс
+class StopIndex {
+public:
+    explicit StopIndex(const std::vector<const domain::Stop*>& stops);
+
+    //count ближайших к point остановок по возрастанию расстояния
+    std::vector<NearbyStop> FindNearest(geo::Coordinates point, size_t count) const;
+
+    //Остановки не дальше radius метров от point по возрастанию расстояния
+    std::vector<NearbyStop> FindInRadius(geo::Coordinates point, double radius) const;
+
+private:
+    struct Point {
+        double coordinates[3];
+        const domain::Stop* stop;
+        uint8_t axis;  //Ось разбиения поддерева с корнем в этой точке
+    };
+
+    struct Query;
+
+    //Дерево неявное: корень отрезка [first, last) - его середина, левое и правое поддеревья - половины
+    void Build(size_t first, size_t last);
+
+    void SearchNearest(size_t first, size_t last, Query& query) const;
+    void SearchInRadius(size_t first, size_t last, Query& query) const;
+
+    //Сортирует найденные точки по точному расстоянию до point, при равенстве - по имени
+    std::vector<NearbyStop> MakeResult(geo::Coordinates point, const std::vector<size_t>& found) const;
+
+    std::vector<Point> points_;
+};
+}  // namespace spatial_index
@@ -0,0 +1,246 @@
+//Сверяет маршруты TransportRouter после AddBus/RemoveBus/UpdateDistance с роутером, построенным с нуля,
+//и дочиненную таблицу graph::Router - с таблицей, посчитанной заново, в том числе при равных маршрутах.
+//Сборка из каталога transport-catalogue:
+//g++ -std=c++17 -O2 -pthread -I. tests/incremental_router_test.cpp transport_catalogue.cpp transport_router.cpp
+//    routing_index.cpp thread_pool.cpp geo.cpp domain.cpp -o incremental_router_test
+
+#include "router.h"
+#include "thread_pool.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+//Маршруты совпадают до ребер: тот же вес, те же перегоны и автобусы
+bool SameRoute(const router::TransportRouter& lhs_router, const router::TransportRouter& rhs_router,
+               const optional<graph::RouterEngine<double>::RouteInfo>& lhs,
+               const optional<graph::RouterEngine<double>::RouteInfo>& rhs) {
+    if(!lhs || !rhs) {
+        return !lhs && !rhs;
+    }
+    if(lhs->weight != rhs->weight || lhs->edges.size() != rhs->edges.size()) {
+        return false;
+    }
+    for(size_t i = 0; i < lhs->edges.size(); ++i) {
+        const auto& lhs_edge = *lhs->edges[i];
+        const auto& rhs_edge = *rhs->edges[i];
+        if(lhs_edge.from != rhs_edge.from || lhs_edge.to != rhs_edge.to || lhs_edge.span_count != rhs_edge.span_count
+           || lhs_edge.weight != rhs_edge.weight
+           || lhs_router.GetEdgeName(lhs_edge) != rhs_router.GetEdgeName(rhs_edge)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Случайная сеть из stop_count остановок и серия изменений; возвращает число расхождений.
+//repairs - число замен ребер, после которых таблица ALL_PAIRS дочинена на месте
+int RunCase(unsigned seed, int stop_count, const router::SettingsTransportRouter& settings, size_t& repairs) {
+    mt19937 rng(seed);
+    TransportCatalogue catalogue;
+
+    vector<string> stops;
+    for(int i = 0; i < stop_count; ++i) {
+        stops.push_back("S"s + to_string(i));
+        domain::Stop stop;
+        stop.name_stop = stops.back();
+        stop.coordinates = {55.5 + (rng() % 1000) / 3000., 37.4 + (rng() % 1000) / 3000.};
+        catalogue.AddStop(stop);
+    }
+    auto random_distance = [&rng] {
+        return double(100 + rng() % 5000);
+    };
+    for(int i = 0; i < stop_count * 3; ++i) {
+        catalogue.AddDistance(stops[rng() % stop_count], stops[rng() % stop_count], random_distance());
+    }
+
+    vector<string> buses;
+    //Каждый перегон маршрута получает расстояния в обе стороны: перегон с нулевым весом дал бы
+    //равные маршруты, и таблица ALL_PAIRS никогда не дочинивалась бы на месте. Уже заданные
+    //расстояния AddDistance не меняет, поэтому ребра прежних маршрутов остаются прежними
+    auto add_bus = [&] {
+        vector<string_view> route;
+        for(int i = 2 + rng() % 6; i > 0; --i) {
+            route.push_back(stops[rng() % stop_count]);
+        }
+        for(size_t i = 1; i < route.size(); ++i) {
+            catalogue.AddDistance(route[i - 1], route[i], random_distance());
+            catalogue.AddDistance(route[i], route[i - 1], random_distance());
+        }
+        buses.push_back("B"s + to_string(rng()));
+        catalogue.AddBus(buses.back(), route, rng() % 2);
+    };
+    for(int i = 0; i < stop_count / 2 + 2; ++i) {
+        add_bus();
+    }
+
+    router::TransportRouter incremental(settings, catalogue);
+    int mismatches = 0;
+
+    for(int step = 0; step < 30; ++step) {
+        const int operation = rng() % 3;
+        if(operation == 0) {
+            add_bus();
+            incremental.AddBus(buses.back());
+        } else if(operation == 1 && buses.size() > 2) {
+            const size_t index = rng() % buses.size();
+            catalogue.RemoveBus(buses[index]);
+            incremental.RemoveBus(buses[index]);
+            buses.erase(buses.begin() + index);
+        } else {
+            const auto& route = catalogue.FindBus(buses[rng() % buses.size()])->stops_for_bus;
+            const size_t index = rng() % (route.size() - 1);
+            const string from = route[index]->name_stop;
+            const string to = route[index + 1]->name_stop;
+            catalogue.SetDistance(from, to, random_distance());
+            incremental.UpdateDistance(from, to);
+        }
+
+        const router::TransportRouter cold(settings, catalogue);
+        for(const string& from : stops) {
+            for(const string& to : stops) {
+                if(!SameRoute(incremental, cold, incremental.BuildOptimazedRoute(from, to),
+                              cold.BuildOptimazedRoute(from, to))) {
+                    ++mismatches;
+                }
+            }
+        }
+    }
+    repairs += incremental.GetTableRepairCount();
+    return mismatches;
+}
+
+//Таблица дочиненного роутера совпадает с посчитанной заново: те же последние ребра маршрутов и веса
+bool SameTable(const graph::Router<double>& repaired, const graph::Router<double>& cold, size_t vertex_count) {
+    for(size_t i = 0; i < vertex_count * vertex_count; ++i) {
+        if(repaired.GetTablePrevEdges()[i] != cold.GetTablePrevEdges()[i]
+           || repaired.GetTableWeights()[i] != cold.GetTableWeights()[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Случайный граф и серия замен его ребер. С integer_weights у ребер малые целые веса, и равных
+//маршрутов много. Дочинка либо совпадает с таблицей, посчитанной заново, либо отказывается, и тогда
+//таблица считается заново, как в TransportRouter. repairs - число удавшихся дочинок
+int RunTableCase(unsigned seed, bool integer_weights, parallel::ThreadPool& thread_pool, int& repairs) {
+    mt19937 rng(seed);
+    const size_t vertex_count = 6 + rng() % 30;
+    graph::DirectedWeightedGraph<double> graph(vertex_count);
+    const graph::NameId name = graph.AddName("E"sv);
+    auto random_edge = [&] {
+        graph::Edge<double> edge;
+        edge.name = name;
+        edge.from = rng() % vertex_count;
+        edge.to = rng() % vertex_count;
+        edge.weight = integer_weights ? double(1 + rng() % 4) : 1. + (rng() % 1000000) / 1000.;
+        return edge;
+    };
+
+    for(size_t i = 0; i < vertex_count * 3; ++i) {
+        graph.AddEdge(random_edge());
+    }
+    graph.Freeze();
+
+    auto repaired = make_unique<graph::Router<double>>(graph, thread_pool);
+    int mismatches = 0;
+
+    for(int step = 0; step < 20; ++step) {
+        //Заменяет несколько ребер подряд: часть остается прежней, часть меняется, число может измениться
+        const graph::EdgeId first = rng() % (graph.GetEdgeCount() + 1);
+        const graph::EdgeId old_last = min<graph::EdgeId>(graph.GetEdgeCount(), first + rng() % 4);
+        vector<graph::Edge<double>> edges;
+        for(int i = rng() % 4; i > 0; --i) {
+            const graph::EdgeId old_id = first + edges.size();
+            edges.push_back(old_id < old_last && rng() % 2 ? graph.GetEdge(old_id) : random_edge());
+        }
+
+        vector<bool> is_kept(min<size_t>(old_last - first, edges.size()));
+        for(size_t i = 0; i < is_kept.size(); ++i) {
+            const auto& old_edge = graph.GetEdge(first + i);
+            is_kept[i] = old_edge.from == edges[i].from && old_edge.to == edges[i].to && old_edge.weight == edges[i].weight;
+        }
+
+        graph.ReplaceEdges(first, old_last, edges);
+        if(repaired->RepairReplacedEdges(first, old_last, first + edges.size(), is_kept, thread_pool)) {
+            ++repairs;
+        } else {
+            repaired = make_unique<graph::Router<double>>(graph, thread_pool);
+        }
+
+        if(!SameTable(*repaired, graph::Router<double>(graph, thread_pool), vertex_count)) {
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+}  // namespace
+
+int main() {
+    int failures = 0;
+
+    parallel::ThreadPool thread_pool(2);
+    for(const bool integer_weights : {false, true}) {
+        int repairs = 0;
+        for(unsigned seed = 1; seed <= 50; ++seed) {
+            const int mismatches = RunTableCase(seed, integer_weights, thread_pool, repairs);
+            if(mismatches) {
+                cerr << "route table" << (integer_weights ? " with ties"s : ""s) << " seed " << seed << ": "
+                     << mismatches << " repaired tables differ from a cold build\n";
+                ++failures;
+            }
+        }
+        //Без равных маршрутов таблица должна дочиниваться, а не считаться заново
+        if(!integer_weights && repairs == 0) {
+            cerr << "route table: no repair succeeded\n";
+            ++failures;
+        }
+    }
+
+    for(const string& engine : {"all_pairs"s, "dijkstra"s, "astar"s, "contraction_hierarchy"s, "raptor"s}) {
+        for(const bool float_table : {false, true}) {
+            if(float_table && engine != "all_pairs"s) {
+                continue;
+            }
+            router::SettingsTransportRouter settings;
+            settings.wait_time = 6;
+            settings.velocity = 40.;
+            settings.engine = router::ParseRoutingEngine(engine);
+            settings.float_route_table = float_table;
+            settings.thread_count = 2;
+
+            size_t repairs = 0;
+            for(unsigned seed = 1; seed <= 8; ++seed) {
+                for(const int stop_count : {8, 40}) {
+                    const int mismatches = RunCase(seed, stop_count, settings, repairs);
+                    if(mismatches) {
+                        cerr << engine << (float_table ? " float"s : ""s) << " seed " << seed << " stops " << stop_count
+                             << ": " << mismatches << " routes differ from a cold rebuild\n";
+                        ++failures;
+                    }
+                }
+            }
+            //Таблица ALL_PAIRS должна хотя бы иногда дочиниваться на месте, а не считаться заново
+            if(engine == "all_pairs"s && repairs == 0) {
+                cerr << engine << (float_table ? " float"s : ""s) << ": no update was repaired in place\n";
+                ++failures;
+            }
+        }
+    }
+
+    if(failures) {
+        return 1;
+    }
+    cout << "OK\n";
+    return 0;
+}
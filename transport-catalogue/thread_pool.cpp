@@ -0,0 +1,115 @@
+#include "thread_pool.h"
+
+namespace parallel {
+size_t GetDefaultThreadCount() {
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads == 0 ? 1 : hardware_threads;
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = GetDefaultThreadCount();
+    }
+
+    //Один из потоков - вызывающий ParallelFor, поэтому рабочих на единицу меньше
+    workers_.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+        workers_.emplace_back([this] {
+            RunWorker();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopped_ = true;
+    }
+    task_ready_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    if (workers_.empty() || count == 1) {
+        for (size_t index = 0; index < count; ++index) {
+            task(index);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        task_ = &task;
+        task_count_ = count;
+        next_index_ = 0;
+        busy_workers_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    task_ready_.notify_all();
+
+    RunTasks();
+
+    std::unique_lock lock(mutex_);
+    task_done_.wait(lock, [this] {
+        return busy_workers_ == 0;
+    });
+    task_ = nullptr;
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void ThreadPool::RunWorker() {
+    size_t seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            task_ready_.wait(lock, [this, seen_generation] {
+                return stopped_ || generation_ != seen_generation;
+            });
+
+            if (stopped_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        RunTasks();
+
+        {
+            std::lock_guard lock(mutex_);
+            --busy_workers_;
+        }
+        task_done_.notify_one();
+    }
+}
+
+void ThreadPool::RunTasks() {
+    for (size_t index = next_index_++; index < task_count_; index = next_index_++) {
+        try {
+            (*task_)(index);
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            //Оставшиеся индексы не раздаем
+            next_index_ = task_count_;
+        }
+    }
+}
+}  // namespace parallel
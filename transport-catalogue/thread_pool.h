@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+//Пул потоков для параллельных циклов по независимым индексам.
+//Потоки создаются один раз и переиспользуются между вызовами ParallelFor
+class ThreadPool {
+public:
+    //thread_count == 0 - по числу аппаратных потоков
+    explicit ThreadPool(size_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Общее число потоков, включая вызывающий
+    size_t GetThreadCount() const;
+
+    //Вызывает task(index) для каждого index из [0, count) и ждет завершения всех вызовов.
+    //Вызывающий поток тоже участвует в работе. Первое исключение из task пробрасывается наружу
+    void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable task_done_;
+
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t task_count_ = 0;
+    std::atomic<size_t> next_index_ = 0;
+    size_t generation_ = 0;
+    size_t busy_workers_ = 0;
+    bool stopped_ = false;
+    std::exception_ptr error_;
+
+    void RunWorker();
+    void RunTasks();
+};
+
+//Число потоков по умолчанию: hardware_concurrency, но не меньше одного
+size_t GetDefaultThreadCount();
+}  // namespace parallel
@@ -1,59 +1,328 @@
 #include "transport_catalogue.h"
 
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
 using namespace std::literals;
 using namespace domain;
 
 using geo::Coordinates;
 using std::deque;
 using std::move;
-using std::set;
 using std::string;
 using std::string_view;
 using std::vector;
 using std::unordered_set;
 using std::unordered_map;
 
-using PairStops = std::pair<const Stop*,const Stop*>;
-
 void TransportCatalogue::AddStop(const Stop& stop) {
+    CheckNotFrozen();
+
     stops_.push_back(stop);
+    stops_.back().id = static_cast<StopId>(stops_.size() - 1);
+    stops_.back().prepared_coordinates = geo::PrepareCoordinates(stop.coordinates);
 
-    buses_for_stop_[stops_.back().name_stop];
+    buses_for_stop_.emplace_back();
+    distances_from_stop_.emplace_back();
     stopname_to_stop_[stops_.back().name_stop] = &stops_.back();
 }
 
 void TransportCatalogue::AddBus(const string& name_bus, const vector<string_view>& name_stops_for_bus, bool is_roundtrip) {
-    vector<const Stop*> stops_for_bus;
+    vector<StopId> stops_for_bus;
     stops_for_bus.reserve(name_stops_for_bus.size());
 
-    buses_.push_back({name_bus, stops_for_bus, is_roundtrip});
+    for(const auto& stop : name_stops_for_bus) {
+        stops_for_bus.push_back(GetStop(stop).id);
+    }
+
+    AddBus(name_bus, stops_for_bus, is_roundtrip);
+}
+
+void TransportCatalogue::AddBus(const string& name_bus, const vector<StopId>& stop_ids, bool is_roundtrip) {
+    CheckNotFrozen();
+
+    vector<const Stop*> stops_for_bus;
+    stops_for_bus.reserve(stop_ids.size());
+
+    for(const StopId stop_id : stop_ids) {
+        if(stop_id >= stops_.size()) {
+            throw std::invalid_argument("Stop not in the catalogue"s);
+        }
+        stops_for_bus.push_back(&stops_[stop_id]);
+    }
+
+    //Буфер вектора не перемещается вместе с ним, поэтому маршрут может ссылаться на него
+    stops_for_buses_.push_back(move(stops_for_bus));
+    const auto& stops = stops_for_buses_.back();
+
+    buses_.push_back({name_bus, StopsRange(stops.data(), stops.data() + stops.size()), is_roundtrip,
+                      static_cast<BusId>(buses_.size())});
     busname_to_bus_[buses_.back().name_bus] = &buses_.back();
 
-    for(const auto& stop : name_stops_for_bus) {
-        stops_for_bus.push_back(FindStop(stop));
-        buses_for_stop_.at(stop).insert(buses_.back().name_bus);
+    for(const auto& stop : stops) {
+        AddBusForStop(stop->id, buses_.back().name_bus);
     }
-    buses_.back().stops_for_bus = move(stops_for_bus);
+    bus_stats_.push_back(ComputeBusStats(buses_.back()));
 }
 
 void TransportCatalogue::AddDistance(string_view stop_from, string_view stop_to, double distance) { 
-    const auto ptr_stop_from = FindStop(stop_from);
-    const auto ptr_stop_to = FindStop(stop_to);
+    AddDistance(GetStop(stop_from).id, GetStop(stop_to).id, distance);
+}
+
+void TransportCatalogue::AddDistance(StopId stop_from, StopId stop_to, double distance) {
+    CheckNotFrozen();
+
+    if(stop_from >= stops_.size() || stop_to >= stops_.size()) {
+        throw std::invalid_argument("Stop not in the catalogue"s);
+    }
+
+    auto& distances = distances_from_stop_[stop_from];
+    const size_t slot = FindDistanceSlot(stop_from, stop_to);
+    if(slot == distances.size() || distances[slot].stop_to != stop_to) {
+        distances.insert(distances.begin() + slot, {stop_to, distance});
+        UpdateRouteLengths(stop_from);
+    }
+}
+
+void TransportCatalogue::Freeze() {
+    if(is_frozen_) {
+        return;
+    }
+
+    //Маршруты остановок по id переводятся, пока имена маршрутов еще на месте
+    stop_buses_offsets_.assign(stops_.size() + 1, 0);
+    for(StopId stop_id = 0; stop_id < stops_.size(); ++stop_id) {
+        stop_buses_offsets_[stop_id + 1] = stop_buses_offsets_[stop_id]
+                                           + static_cast<uint32_t>(buses_for_stop_[stop_id].size());
+    }
+
+    vector<BusId> stop_bus_ids;
+    stop_bus_ids.reserve(stop_buses_offsets_.back());
+    for(const auto& buses : buses_for_stop_) {
+        for(const auto name_bus : buses) {
+            stop_bus_ids.push_back(busname_to_bus_.at(name_bus)->id);
+        }
+    }
+
+    size_t distance_count = 0;
+    for(const auto& distances : distances_from_stop_) {
+        distance_count += distances.size();
+    }
+
+    distances_.Reserve(distance_count);
+    for(StopId stop_from = 0; stop_from < distances_from_stop_.size(); ++stop_from) {
+        for(const auto& [stop_to, distance] : distances_from_stop_[stop_from]) {
+            distances_.Insert(stop_from, stop_to, distance);
+        }
+    }
+
+    frozen_stops_.assign(std::make_move_iterator(stops_.begin()), std::make_move_iterator(stops_.end()));
+
+    size_t bus_stop_count = 0;
+    for(const auto& stops : stops_for_buses_) {
+        bus_stop_count += stops.size();
+    }
+
+    //Места хватает на все остановки сразу, bus_stops_ не перевыделяется и отрезки маршрутов остаются верными
+    bus_stops_.reserve(bus_stop_count);
+    frozen_buses_.reserve(buses_.size());
+    for(size_t i = 0; i < buses_.size(); ++i) {
+        const size_t offset = bus_stops_.size();
+        for(const Stop* stop : stops_for_buses_[i]) {
+            bus_stops_.push_back(&frozen_stops_[stop->id]);
+        }
+
+        Bus& bus = buses_[i];
+        frozen_buses_.push_back({move(bus.name_bus),
+                                 StopsRange(bus_stops_.data() + offset, bus_stops_.data() + bus_stops_.size()),
+                                 bus.is_roundtrip, bus.id});
+    }
+
+    //Имена маршрутов окончательно на месте, остановки ссылаются на них
+    stop_buses_.reserve(stop_bus_ids.size());
+    for(const BusId bus_id : stop_bus_ids) {
+        stop_buses_.push_back(frozen_buses_[bus_id].name_bus);
+    }
+
+    BuildNameIndexes();
+    is_frozen_ = true;
+
+    deque<Bus>().swap(buses_);
+    deque<vector<const Stop*>>().swap(stops_for_buses_);
+    deque<Stop>().swap(stops_);
+    unordered_map<string_view, const Stop*>().swap(stopname_to_stop_);
+    unordered_map<string_view, const Bus*>().swap(busname_to_bus_);
+    vector<vector<string_view>>().swap(buses_for_stop_);
+    vector<vector<DistanceToStop>>().swap(distances_from_stop_);
+}
+
+void TransportCatalogue::LoadFrozen(vector<Stop> stops, vector<FrozenBus> buses,
+                                    const vector<StopId>& bus_stops, const vector<RoadDistance>& distances) {
+    CheckNotFrozen();
+    if(!stops_.empty() || !buses_.empty()) {
+        throw std::invalid_argument("Catalogue should be empty"s);
+    }
 
-    distance_between_stops_.insert({std::make_pair(ptr_stop_from, ptr_stop_to), distance});
+    //Все данные проверяются до изменения справочника
+    for(const StopId stop_id : bus_stops) {
+        if(stop_id >= stops.size()) {
+            throw std::invalid_argument("Stop not in the catalogue"s);
+        }
+    }
+    for(const auto& bus : buses) {
+        if(bus.first_stop > bus_stops.size() || bus.stop_count > bus_stops.size() - bus.first_stop) {
+            throw std::invalid_argument("Bus stops are out of range"s);
+        }
+    }
+    for(const auto& [stop_from, stop_to, distance] : distances) {
+        if(stop_from >= stops.size() || stop_to >= stops.size()) {
+            throw std::invalid_argument("Stop not in the catalogue"s);
+        }
+    }
+
+    frozen_stops_ = move(stops);
+    for(StopId stop_id = 0; stop_id < frozen_stops_.size(); ++stop_id) {
+        frozen_stops_[stop_id].id = stop_id;
+        frozen_stops_[stop_id].prepared_coordinates = geo::PrepareCoordinates(frozen_stops_[stop_id].coordinates);
+    }
+
+    bus_stops_.reserve(bus_stops.size());
+    for(const StopId stop_id : bus_stops) {
+        bus_stops_.push_back(&frozen_stops_[stop_id]);
+    }
+
+    frozen_buses_.reserve(buses.size());
+    bus_stats_.reserve(buses.size());
+    for(size_t i = 0; i < buses.size(); ++i) {
+        FrozenBus& bus = buses[i];
+        const Stop* const* first = bus_stops_.data() + bus.first_stop;
+        frozen_buses_.push_back({move(bus.name_bus), StopsRange(first, first + bus.stop_count),
+                                 bus.is_roundtrip, static_cast<BusId>(i)});
+        bus_stats_.push_back(bus.stats);
+    }
+
+    distances_.Reserve(distances.size());
+    for(const auto& [stop_from, stop_to, distance] : distances) {
+        distances_.Insert(stop_from, stop_to, distance);
+    }
+
+    //Маршруты остановок: маршруты обходятся по возрастанию имени, тогда и внутри остановки
+    //имена идут по возрастанию. Повтор остановки в маршруте отсекается по последнему маршруту
+    vector<BusId> bus_order(frozen_buses_.size());
+    std::iota(bus_order.begin(), bus_order.end(), BusId{0});
+    std::sort(bus_order.begin(), bus_order.end(), [this](BusId lhs, BusId rhs) {
+        return frozen_buses_[lhs].name_bus < frozen_buses_[rhs].name_bus;
+    });
+
+    constexpr BusId NO_BUS = std::numeric_limits<BusId>::max();
+    vector<BusId> last_bus(frozen_stops_.size(), NO_BUS);
+    stop_buses_offsets_.assign(frozen_stops_.size() + 1, 0);
+    for(const BusId bus_id : bus_order) {
+        for(const Stop* stop : frozen_buses_[bus_id].stops_for_bus) {
+            if(last_bus[stop->id] != bus_id) {
+                last_bus[stop->id] = bus_id;
+                ++stop_buses_offsets_[stop->id + 1];
+            }
+        }
+    }
+    for(StopId stop_id = 0; stop_id < frozen_stops_.size(); ++stop_id) {
+        stop_buses_offsets_[stop_id + 1] += stop_buses_offsets_[stop_id];
+    }
+
+    stop_buses_.resize(stop_buses_offsets_.back());
+    vector<uint32_t> positions(stop_buses_offsets_.begin(), stop_buses_offsets_.end() - 1);
+    last_bus.assign(frozen_stops_.size(), NO_BUS);
+    for(const BusId bus_id : bus_order) {
+        for(const Stop* stop : frozen_buses_[bus_id].stops_for_bus) {
+            if(last_bus[stop->id] != bus_id) {
+                last_bus[stop->id] = bus_id;
+                stop_buses_[positions[stop->id]++] = frozen_buses_[bus_id].name_bus;
+            }
+        }
+    }
+
+    BuildNameIndexes();
+    is_frozen_ = true;
+}
+
+bool TransportCatalogue::IsFrozen() const {
+    return is_frozen_;
 }
 
-const set<string_view> TransportCatalogue::FindBusesForStop(std::string_view name_stop) const {
-    auto iter = buses_for_stop_.find(name_stop);
+void TransportCatalogue::RemoveBus(string_view name_bus) {
+    CheckNotFrozen();
 
-    if(iter == buses_for_stop_.end()) {
+    const auto iter_bus = std::find_if(buses_.begin(), buses_.end(), [name_bus](const Bus& bus) {
+        return bus.name_bus == name_bus;
+    });
+
+    if(iter_bus == buses_.end()) {
+        throw std::invalid_argument("Bus not in the catalogue"s);
+    }
+
+    stops_for_buses_.erase(stops_for_buses_.begin() + (iter_bus - buses_.begin()));
+    bus_stats_.erase(bus_stats_.begin() + (iter_bus - buses_.begin()));
+    buses_.erase(iter_bus);
+
+    //Удаление из середины deque перемещает маршруты, id и индексы по именам строятся заново
+    busname_to_bus_.clear();
+    for(auto& buses : buses_for_stop_) {
+        buses.clear();
+    }
+
+    for(size_t i = 0; i < buses_.size(); ++i) {
+        Bus& bus = buses_[i];
+        bus.id = static_cast<BusId>(i);
+        busname_to_bus_[bus.name_bus] = &bus;
+
+        for(const auto& stop : bus.stops_for_bus) {
+            AddBusForStop(stop->id, bus.name_bus);
+        }
+    }
+}
+
+void TransportCatalogue::SetDistance(string_view stop_from, string_view stop_to, double distance) {
+    CheckNotFrozen();
+
+    const StopId id_from = GetStop(stop_from).id;
+    const StopId id_to = GetStop(stop_to).id;
+
+    auto& distances = distances_from_stop_[id_from];
+    const size_t slot = FindDistanceSlot(id_from, id_to);
+    if(slot == distances.size() || distances[slot].stop_to != id_to) {
+        distances.insert(distances.begin() + slot, {id_to, distance});
+    } else {
+        distances[slot].distance = distance;
+    }
+    UpdateRouteLengths(id_from);
+}
+
+TransportCatalogue::BusNamesRange TransportCatalogue::FindBusesForStop(std::string_view name_stop) const {
+    return FindBusesForStop(GetStop(name_stop).id);
+}
+
+TransportCatalogue::BusNamesRange TransportCatalogue::FindBusesForStop(StopId stop_id) const {
+    if(stop_id >= GetStopsCount()) {
         throw std::invalid_argument("Stop not in the catalogue"s);
     }
 
-    return buses_for_stop_.find(name_stop)->second;
+    if(!is_frozen_) {
+        const auto& buses = buses_for_stop_[stop_id];
+        return BusNamesRange(buses.data(), buses.data() + buses.size());
+    }
+
+    return BusNamesRange(stop_buses_.data() + stop_buses_offsets_[stop_id],
+                         stop_buses_.data() + stop_buses_offsets_[stop_id + 1]);
 }
 
 const Stop* TransportCatalogue::FindStop(string_view name_stop) const {
+    if(is_frozen_) {
+        const auto stop_id = stops_by_name_.Find(name_stop);
+        return stop_id ? &frozen_stops_[*stop_id] : nullptr;
+    }
+
     auto iter = stopname_to_stop_.find(name_stop);
 
     if(iter == stopname_to_stop_.end()) {
@@ -63,7 +332,20 @@ const Stop* TransportCatalogue::FindStop(string_view name_stop) const {
     return iter->second;
 }
 
+const Stop* TransportCatalogue::FindStop(StopId stop_id) const {
+    if(stop_id >= GetStopsCount()) {
+        return nullptr;
+    }
+
+    return is_frozen_ ? &frozen_stops_[stop_id] : &stops_[stop_id];
+}
+
 const Bus* TransportCatalogue::FindBus(string_view name_bus) const {
+    if(is_frozen_) {
+        const auto bus_id = buses_by_name_.Find(name_bus);
+        return bus_id ? &frozen_buses_[*bus_id] : nullptr;
+    }
+
     auto iter = busname_to_bus_.find(name_bus);
 
     if(iter == busname_to_bus_.end()) {
@@ -73,31 +355,212 @@ const Bus* TransportCatalogue::FindBus(string_view name_bus) const {
     return iter->second;
 }
 
+const Bus* TransportCatalogue::FindBus(BusId bus_id) const {
+    if(bus_id >= GetBusesCount()) {
+        return nullptr;
+    }
+
+    return is_frozen_ ? &frozen_buses_[bus_id] : &buses_[bus_id];
+}
+
 std::optional<double> TransportCatalogue::FindDistance(const Stop* stop_from, const Stop* stop_to) const {
-    auto iter_from_to = distance_between_stops_.find(PairStops{stop_from, stop_to});
-    if(iter_from_to != nullptr) {
-        return iter_from_to->second;
+    return FindDistance(stop_from->id, stop_to->id);
+}
+
+std::optional<double> TransportCatalogue::FindDistance(StopId stop_from, StopId stop_to) const {
+    if(stop_from >= GetStopsCount() || stop_to >= GetStopsCount()) {
+        return std::nullopt;
+    }
+
+    if(is_frozen_) {
+        if(const auto from_to = distances_.Find(stop_from, stop_to)) {
+            return from_to;
+        }
+        return distances_.Find(stop_to, stop_from);
     }
 
-    auto iter_to_from = distance_between_stops_.find(PairStops{stop_to, stop_from});
-    if(iter_to_from != nullptr) {
-        return iter_to_from->second;
+    auto find_in = [this](StopId from, StopId to) -> const DistanceToStop* {
+        const auto& distances = distances_from_stop_[from];
+        const size_t slot = FindDistanceSlot(from, to);
+
+        return slot != distances.size() && distances[slot].stop_to == to ? &distances[slot] : nullptr;
+    };
+
+    if(const auto* from_to = find_in(stop_from, stop_to)) {
+        return from_to->distance;
+    }
+
+    if(const auto* to_from = find_in(stop_to, stop_from)) {
+        return to_from->distance;
     }
     
     return std::nullopt;
 }
 
+const Stop& TransportCatalogue::GetStop(string_view name_stop) const {
+    const Stop* stop = FindStop(name_stop);
+
+    if(stop == nullptr) {
+        throw std::invalid_argument("Stop not in the catalogue"s);
+    }
+
+    return *stop;
+}
+
+size_t TransportCatalogue::FindDistanceSlot(StopId stop_from, StopId stop_to) const {
+    //Соседей у остановки немного, бинарный поиск по отсортированному вектору
+    const auto& distances = distances_from_stop_[stop_from];
+    const auto iter = std::lower_bound(distances.begin(), distances.end(), stop_to,
+                                       [](const DistanceToStop& item, StopId stop) {
+                                           return item.stop_to < stop;
+                                       });
+
+    return iter - distances.begin();
+}
+
+void TransportCatalogue::AddBusForStop(StopId stop_id, string_view name_bus) {
+    auto& buses = buses_for_stop_[stop_id];
+    const auto iter = std::lower_bound(buses.begin(), buses.end(), name_bus);
+
+    if(iter == buses.end() || *iter != name_bus) {
+        buses.insert(iter, name_bus);
+    }
+}
+
+void TransportCatalogue::UpdateRouteLengths(StopId stop_id) {
+    for(const auto name_bus : buses_for_stop_[stop_id]) {
+        const Bus& bus = *busname_to_bus_.at(name_bus);
+        bus_stats_[bus.id].route_length = ComputeRouteLength(bus);
+    }
+}
+
+void TransportCatalogue::BuildNameIndexes() {
+    vector<string_view> names;
+    names.reserve(frozen_stops_.size());
+    for(const auto& stop : frozen_stops_) {
+        names.push_back(stop.name_stop);
+    }
+    stops_by_name_.Build(move(names));
+
+    names.clear();
+    for(const auto& bus : frozen_buses_) {
+        names.push_back(bus.name_bus);
+    }
+    buses_by_name_.Build(move(names));
+}
+
+void TransportCatalogue::CheckNotFrozen() const {
+    if(is_frozen_) {
+        throw std::logic_error("Can't modify frozen catalogue"s);
+    }
+}
+
+//Размер хеш-таблицы на count элементов: степень двойки, заполнение не больше половины,
+//чтобы цепочки пробирования оставались короткими
+static size_t ComputeTableCapacity(size_t count) {
+    size_t capacity = 1;
+    while(capacity < count * 2) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+//_____DistanceTable_____
+void TransportCatalogue::DistanceTable::Reserve(size_t count) {
+    slots_.assign(ComputeTableCapacity(count), Slot{});
+}
+
+void TransportCatalogue::DistanceTable::Insert(StopId stop_from, StopId stop_to, double distance) {
+    const uint64_t key = (static_cast<uint64_t>(stop_from) << 32) | stop_to;
+    Slot& slot = slots_[FindSlot(key)];
+
+    slot.key = key;
+    slot.distance = distance;
+}
+
+std::optional<double> TransportCatalogue::DistanceTable::Find(StopId stop_from, StopId stop_to) const {
+    const uint64_t key = (static_cast<uint64_t>(stop_from) << 32) | stop_to;
+    const Slot& slot = slots_[FindSlot(key)];
+
+    if(slot.key != key) {
+        return std::nullopt;
+    }
+    return slot.distance;
+}
+
+void TransportCatalogue::DistanceTable::AppendTo(vector<RoadDistance>& distances) const {
+    for(const Slot& slot : slots_) {
+        if(slot.key != EMPTY_KEY) {
+            distances.push_back({static_cast<StopId>(slot.key >> 32), static_cast<StopId>(slot.key), slot.distance});
+        }
+    }
+}
+
+size_t TransportCatalogue::DistanceTable::FindSlot(uint64_t key) const {
+    const size_t mask = slots_.size() - 1;
+
+    //Мультипликативное хеширование Фибоначчи, старшие биты подмешиваются в младшие
+    uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+    size_t index = static_cast<size_t>(hash ^ (hash >> 32)) & mask;
+
+    while(slots_[index].key != EMPTY_KEY && slots_[index].key != key) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+//_____NameIndex_____
+void TransportCatalogue::NameIndex::Build(vector<string_view> names) {
+    names_ = move(names);
+    slots_.assign(ComputeTableCapacity(names_.size()), Slot{});
+
+    const size_t mask = slots_.size() - 1;
+    for(uint32_t id = 0; id < names_.size(); ++id) {
+        const size_t hash = std::hash<string_view>{}(names_[id]);
+        const auto tag = static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32);
+        size_t index = hash & mask;
+
+        //Повторное имя занимает слот прежнего: как и в словаре до заморозки, находится последний id
+        while(slots_[index].id != EMPTY_ID
+              && !(slots_[index].tag == tag && names_[slots_[index].id] == names_[id])) {
+            index = (index + 1) & mask;
+        }
+        slots_[index] = {tag, id};
+    }
+}
+
+std::optional<uint32_t> TransportCatalogue::NameIndex::Find(string_view name) const {
+    const size_t mask = slots_.size() - 1;
+    const size_t hash = std::hash<string_view>{}(name);
+    const auto tag = static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32);
+
+    for(size_t index = hash & mask; slots_[index].id != EMPTY_ID; index = (index + 1) & mask) {
+        if(slots_[index].tag == tag && names_[slots_[index].id] == name) {
+            return slots_[index].id;
+        }
+    }
+    return std::nullopt;
+}
+
 //false - предоставить сведения о машрутах, в которой есть хоят бы одна остановка
 //true - предоставить сведения о всех маршрутах
 vector<const Bus*> TransportCatalogue::GetBuses(bool get_all_buses) const {
     vector<const Bus*> buses;
 
-    for(const auto& bus : buses_) {
+    auto add_buses = [&buses, get_all_buses](const auto& all_buses) {
+        for(const auto& bus : all_buses) {
 
-        if(!get_all_buses && bus.stops_for_bus.empty()){
-            continue;
+            if(!get_all_buses && bus.stops_for_bus.empty()){
+                continue;
+            }
+            buses.push_back(&bus);
         }
-        buses.push_back(&bus);
+    };
+
+    if(is_frozen_) {
+        add_buses(frozen_buses_);
+    } else {
+        add_buses(buses_);
     }
 
     return buses;
@@ -107,51 +570,103 @@ vector<const Bus*> TransportCatalogue::GetBuses(bool get_all_buses) const {
 //true - предоставить сведения о всех остановках
 std::vector<const domain::Stop*> TransportCatalogue::GetStops(bool get_all_stops) const {
     vector<const Stop*> stops;
-    for(const auto& stop : stops_) {
-        
-        if(!get_all_stops && FindBusesForStop(stop.name_stop).empty()) {
-            continue;
+
+    auto has_buses = [this](StopId stop_id) {
+        return is_frozen_ ? stop_buses_offsets_[stop_id] != stop_buses_offsets_[stop_id + 1]
+                          : !buses_for_stop_[stop_id].empty();
+    };
+
+    auto add_stops = [&stops, &has_buses, get_all_stops](const auto& all_stops) {
+        for(const auto& stop : all_stops) {
+            
+            if(!get_all_stops && !has_buses(stop.id)) {
+                continue;
+            }
+            stops.push_back(&stop);
         }
-        stops.push_back(&stop);
+    };
+
+    if(is_frozen_) {
+        add_stops(frozen_stops_);
+    } else {
+        add_stops(stops_);
     }
 
     return stops;
 }
 
+vector<RoadDistance> TransportCatalogue::GetDistances() const {
+    vector<RoadDistance> distances;
+
+    if(is_frozen_) {
+        distances_.AppendTo(distances);
+        std::sort(distances.begin(), distances.end(), [](const RoadDistance& lhs, const RoadDistance& rhs) {
+            return std::make_pair(lhs.stop_from, lhs.stop_to) < std::make_pair(rhs.stop_from, rhs.stop_to);
+        });
+        return distances;
+    }
+
+    for(StopId stop_from = 0; stop_from < distances_from_stop_.size(); ++stop_from) {
+        for(const auto& [stop_to, distance] : distances_from_stop_[stop_from]) {
+            distances.push_back({stop_from, stop_to, distance});
+        }
+    }
+    return distances;
+}
+
 size_t TransportCatalogue::GetBusesCount() const {
-    return buses_.size();
+    return is_frozen_ ? frozen_buses_.size() : buses_.size();
 }
 
 size_t TransportCatalogue::GetStopsCount() const {
-    return stops_.size();
+    return is_frozen_ ? frozen_stops_.size() : stops_.size();
 }
 
 int TransportCatalogue::ComputeUniqueStops(const Bus& bus) const {
-        std::vector<const Stop*> unique_stops = bus.stops_for_bus;
+        std::vector<const Stop*> unique_stops(bus.stops_for_bus.begin(), bus.stops_for_bus.end());
         std::sort(unique_stops.begin(), unique_stops.end());
         unique_stops.erase(std::unique(unique_stops.begin(), unique_stops.end()), unique_stops.end());
 
         return static_cast<int>(unique_stops.size()); 
     }
 
-    RouteDistanceInfo TransportCatalogue::ComputeRouteDistanceInfo(const Bus& bus) const {
-        double real_distance = 0;
-        double geo_distance = 0;
+BusInfo TransportCatalogue::GetBusInfo(const Bus& bus) const {
+    const BusStats& stats = bus_stats_.at(bus.id);
 
-        const auto& stops_for_bus = bus.stops_for_bus;
+    return BusInfo{bus.name_bus, stats.stops_on_route, stats.unique_stops,
+                   RouteDistanceInfo{stats.route_length, stats.route_length / stats.geo_length}};
+}
 
-        for(size_t i = 0, j = 1; j < bus.stops_for_bus.size(); ++i, ++j) {
-            auto stop_from = stops_for_bus[i];
-            auto stop_to = stops_for_bus[j];
+const TransportCatalogue::BusStats& TransportCatalogue::GetBusStats(BusId bus_id) const {
+    return bus_stats_.at(bus_id);
+}
 
-            auto distance = FindDistance(stop_from, stop_to);
-            if(distance){
-                real_distance += *distance;
-            }
-            
-            geo_distance += ComputeDistance(stop_from->coordinates, stop_to->coordinates);
+double TransportCatalogue::ComputeRouteLength(const Bus& bus) const {
+    double real_distance = 0;
+
+    const auto& stops_for_bus = bus.stops_for_bus;
+    for(size_t i = 0, j = 1; j < stops_for_bus.size(); ++i, ++j) {
+        auto distance = FindDistance(stops_for_bus[i], stops_for_bus[j]);
+        if(distance){
+            real_distance += *distance;
         }
-        double curvature = real_distance / geo_distance;
-        
-        return RouteDistanceInfo{real_distance, curvature};
-    }
\ No newline at end of file
+    }
+
+    return real_distance;
+}
+
+double TransportCatalogue::ComputeGeoLength(const Bus& bus) const {
+    vector<geo::PreparedCoordinates> points;
+    points.reserve(bus.stops_for_bus.size());
+
+    for(const Stop* stop : bus.stops_for_bus) {
+        points.push_back(stop->prepared_coordinates);
+    }
+
+    return geo::ComputePolylineLength(points);
+}
+
+TransportCatalogue::BusStats TransportCatalogue::ComputeBusStats(const Bus& bus) const {
+    return BusStats{static_cast<int>(bus.stops_for_bus.size()), ComputeUniqueStops(bus),
+                    ComputeRouteLength(bus), ComputeGeoLength(bus)};
+}
@@ -1,9 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <optional>
-#include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -13,47 +13,173 @@
 
 #include "geo.h"
 #include "domain.h"
+#include "ranges.h"
 
 class TransportCatalogue {
 public:
+    using BusNamesRange = ranges::Range<const std::string_view*>;
+
     void AddStop(const domain::Stop& stop);
     void AddBus(const std::string& name_bus, const std::vector<std::string_view>& name_stops_for_bus, bool is_roundtrip);
     void AddDistance(std::string_view stop_from, std::string_view stop_to, double distance);
+    //Перегрузки по id - для загрузки уже пронумерованных данных, например из снимка справочника
+    void AddBus(const std::string& name_bus, const std::vector<domain::StopId>& stops_for_bus, bool is_roundtrip);
+    void AddDistance(domain::StopId stop_from, domain::StopId stop_to, double distance);
+
+    //Предрасчитанные сведения о маршруте. Длина по сфере хранится отдельно, чтобы при
+    //изменении расстояний пересчитывать только длину по дорогам
+    struct BusStats {
+        int stops_on_route;
+        int unique_stops;
+        double route_length;
+        double geo_length;
+    };
+
+    //Маршрут для LoadFrozen: остановки - отрезок [first_stop, first_stop + stop_count) общего
+    //массива остановок маршрутов, сведения о маршруте уже посчитаны
+    struct FrozenBus {
+        std::string name_bus;
+        size_t first_stop;
+        size_t stop_count;
+        bool is_roundtrip;
+        BusStats stats;
+    };
+
+    //Строит замороженный справочник сразу из пронумерованных данных, например из снимка:
+    //без AddStop/AddBus/AddDistance, промежуточных индексов и пересчета сведений о маршрутах.
+    //Справочник должен быть пустым. Id остановок и маршрутов - их позиции в stops и buses
+    void LoadFrozen(std::vector<domain::Stop> stops, std::vector<FrozenBus> buses,
+                    const std::vector<domain::StopId>& bus_stops, const std::vector<domain::RoadDistance>& distances);
 
-    const std::set<std::string_view>FindBusesForStop(std::string_view name_stop) const;
+    //Переводит справочник в неизменяемый снимок: остановки и маршруты - в непрерывные массивы,
+    //остановки маршрутов и маршруты остановок - в общие массивы по смещениям (CSR), расстояния -
+    //в хеш-таблицу с открытой адресацией. Все Find*/Get* работают как прежде, но указатели на
+    //остановки и маршруты, полученные до заморозки, становятся недействительными.
+    //После заморозки методы, изменяющие справочник, бросают исключение
+    void Freeze();
+    bool IsFrozen() const;
+
+    //Удаляет маршрут. Указатели и ссылки на остальные маршруты становятся недействительными,
+    //а id маршрутов после удаленного уменьшаются на 1
+    void RemoveBus(std::string_view name_bus);
+    //В отличие от AddDistance, заменяет уже заданное расстояние
+    void SetDistance(std::string_view stop_from, std::string_view stop_to, double distance);
+
+    //Поиск по имени - для разбора запросов. Дальше остановки и маршруты передаются по id,
+    //поиск по которому - обращение по индексу без хеширования строк
+    //Имена маршрутов через остановку по возрастанию, без копирования. Представление
+    //действительно до следующего изменения справочника или его заморозки
+    BusNamesRange FindBusesForStop(std::string_view name_stop) const;
+    BusNamesRange FindBusesForStop(domain::StopId stop_id) const;
     const domain::Stop* FindStop(std::string_view name_stop) const; 
+    const domain::Stop* FindStop(domain::StopId stop_id) const;
     const domain::Bus* FindBus(std::string_view name_bus) const;
+    const domain::Bus* FindBus(domain::BusId bus_id) const;
     std::optional<double> FindDistance(const domain::Stop* stop_from,const domain::Stop* stop_to) const;
+    std::optional<double> FindDistance(domain::StopId stop_from, domain::StopId stop_to) const;
 
     std::vector<const domain::Bus*> GetBuses(bool get_all_buses) const;
     std::vector<const domain::Stop*> GetStops(bool get_all_stops) const;
 
+    //Все заданные расстояния по возрастанию пары (stop_from, stop_to)
+    std::vector<domain::RoadDistance> GetDistances() const;
+
     size_t GetBusesCount() const;
     size_t GetStopsCount() const;
     
-    domain::RouteDistanceInfo ComputeRouteDistanceInfo(const domain::Bus& bus) const;
+    //Сведения о маршруте за O(1): считаются при добавлении маршрута и пересчитываются,
+    //когда меняются расстояния между его остановками
+    domain::BusInfo GetBusInfo(const domain::Bus& bus) const;
+    const BusStats& GetBusStats(domain::BusId bus_id) const;
+
     int ComputeUniqueStops (const domain::Bus& bus) const;
 
 private:
-struct DistanceBetweenStopsHash {    
-        size_t operator() (const std::pair<const domain::Stop*,const domain::Stop*>& stops) const {
-            const auto& [stop_from, stop_to] = stops;
+    //Расстояние до соседней остановки. Соседи каждой остановки отсортированы по stop_to
+    struct DistanceToStop {
+        domain::StopId stop_to;
+        double distance;
+    };
+
+    //Расстояния замороженного справочника: открытая адресация с линейным пробированием,
+    //ключ - пара id остановок в одном 64-битном числе
+    class DistanceTable {
+    public:
+        void Reserve(size_t count);
+        void Insert(domain::StopId stop_from, domain::StopId stop_to, double distance);
+        std::optional<double> Find(domain::StopId stop_from, domain::StopId stop_to) const;
+        void AppendTo(std::vector<domain::RoadDistance>& distances) const;
 
-            size_t hash_stop_from = stop_hasher_(stop_from);
-            size_t hash_stop_to = stop_hasher_(stop_to);
+    private:
+        static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+
+        struct Slot {
+            uint64_t key = EMPTY_KEY;
+            double distance = 0.;
+        };
+
+        size_t FindSlot(uint64_t key) const;
+
+        std::vector<Slot> slots_;  //Размер - степень двойки
+    };
+
+    //Имена замороженного справочника: открытая адресация с линейным пробированием. В ячейке
+    //id и старшие биты хеша имени, строки сравниваются только при совпадении хеша
+    class NameIndex {
+    public:
+        //names[id] - имя с этим id. Строки должны жить, пока используется индекс
+        void Build(std::vector<std::string_view> names);
+        std::optional<uint32_t> Find(std::string_view name) const;
 
-            return 67 * (67 * hash_stop_from + hash_stop_to);
-        }
     private:
-        std::hash<const void*> stop_hasher_;
+        static constexpr uint32_t EMPTY_ID = UINT32_MAX;
+
+        struct Slot {
+            uint32_t tag = 0;
+            uint32_t id = EMPTY_ID;
+        };
+
+        std::vector<std::string_view> names_;
+        std::vector<Slot> slots_;  //Размер - степень двойки
     };
 
+    double ComputeRouteLength(const domain::Bus& bus) const;
+    double ComputeGeoLength(const domain::Bus& bus) const;
+    BusStats ComputeBusStats(const domain::Bus& bus) const;
+    //Пересчитывает длину маршрутов через stop_id: только в них входят расстояния от этой остановки
+    void UpdateRouteLengths(domain::StopId stop_id);
+
+    //Остановка с именем name_stop, исключение - если ее нет в справочнике
+    const domain::Stop& GetStop(std::string_view name_stop) const;
+    //Позиция расстояния stop_from -> stop_to среди соседей stop_from: найденного или того, куда его вставить
+    size_t FindDistanceSlot(domain::StopId stop_from, domain::StopId stop_to) const;
+    void CheckNotFrozen() const;
+    //Индексы имен замороженного справочника по frozen_stops_ и frozen_buses_
+    void BuildNameIndexes();
+    void AddBusForStop(domain::StopId stop_id, std::string_view name_bus);
+
+    bool is_frozen_ = false;
+
+    //До заморозки
     std::deque<domain::Bus> buses_;
+    std::deque<std::vector<const domain::Stop*>> stops_for_buses_;  //Остановки маршрута buses_[i]
     std::deque<domain::Stop> stops_;
     std::unordered_map <std::string_view, const domain::Stop*> stopname_to_stop_;
     std::unordered_map <std::string_view, const domain::Bus*> busname_to_bus_;
-    std::unordered_map <std::string_view, std::set<std::string_view>> buses_for_stop_;
-    std::unordered_map <std::pair<const domain::Stop*, const domain::Stop*>, double, DistanceBetweenStopsHash> distance_between_stops_;
+    //Индексы по StopId
+    std::vector<std::vector<std::string_view>> buses_for_stop_;  //По возрастанию, без повторов
+    std::vector<std::vector<DistanceToStop>> distances_from_stop_;
+    std::vector<BusStats> bus_stats_;  //По BusId, и до, и после заморозки
+
+    //После заморозки
+    std::vector<domain::Stop> frozen_stops_;
+    std::vector<domain::Bus> frozen_buses_;
+    std::vector<const domain::Stop*> bus_stops_;  //Остановки всех маршрутов подряд, маршрут ссылается на свой отрезок
+    NameIndex stops_by_name_;
+    NameIndex buses_by_name_;
+    std::vector<uint32_t> stop_buses_offsets_;    //Маршруты остановки i: [offsets[i], offsets[i + 1]) в stop_buses_
+    std::vector<std::string_view> stop_buses_;    //Имена из frozen_buses_, внутри остановки - по возрастанию
+    DistanceTable distances_;
 };
 
 
@@ -1,5 +1,12 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <utility>
+
 using namespace domain;
 using namespace graph;
 using namespace std::literals;
@@ -12,50 +19,114 @@ using std::vector;
 static const double CONVERT_COEF = 60. / 1000.;
 
 namespace router {
-const optional<Router<double>::RouteInfo> TransportRouter::BuildOptimazedRoute(string_view from, 
+RoutingEngine ParseRoutingEngine(string_view name) {
+    if(name == "all_pairs"sv) {
+        return RoutingEngine::ALL_PAIRS;
+    }
+
+    if(name == "dijkstra"sv) {
+        return RoutingEngine::DIJKSTRA;
+    }
+
+    if(name == "contraction_hierarchy"sv) {
+        return RoutingEngine::CONTRACTION_HIERARCHY;
+    }
+
+    if(name == "astar"sv) {
+        return RoutingEngine::ASTAR;
+    }
+
+    if(name == "raptor"sv) {
+        return RoutingEngine::RAPTOR;
+    }
+
+    throw std::invalid_argument("Unknown routing engine: "s + string(name));
+}
+
+const optional<RouterEngine<double>::RouteInfo> TransportRouter::BuildOptimazedRoute(string_view from, 
                                                                                string_view to) const {
-    return router_->BuildRoute(start_routes_id_.at(string(from)), start_routes_id_.at(string(to)));
+    return BuildOptimazedRoute(GetStopId(from), GetStopId(to));
 }
 
-vector<vector<double>> TransportRouter::ComputeWeightForEdges(const vector<const Stop*>& stops) {
-    vector<vector<double>> result;
+const optional<RouterEngine<double>::RouteInfo> TransportRouter::BuildOptimazedRoute(StopId from, StopId to) const {
+    VerifyIndexRows({GetStopVertex(from)});
+    return router_->BuildRoute(GetStopVertex(from), GetStopVertex(to));
+}
 
-    //Заранее создаем матрицу, размером равным количеству остановок в маршруте
-    result.resize(stops.size(), vector<double>(stops.size()));
+vector<optional<RouterEngine<double>::RouteInfo>> TransportRouter::BuildOptimazedRoutes(string_view from,
+                                                                                     const vector<string_view>& to) const {
+    return BuildOptimazedRoutes(GetStopId(from), GetStopIds(to));
+}
 
-    //Заполняем вес в галвную диагональ
-    for(size_t identical_stop = 0; identical_stop < stops.size(); ++identical_stop) {
-        auto distance_from_to = catalogue_.FindDistance(stops[identical_stop], stops[identical_stop]);
-        if(!distance_from_to){
-            continue;
-        }
+vector<optional<RouterEngine<double>::RouteInfo>> TransportRouter::BuildOptimazedRoutes(StopId from,
+                                                                                     const vector<StopId>& to) const {
+    VerifyIndexRows({GetStopVertex(from)});
+    return router_->BuildRoutes(GetStopVertex(from), GetStopVertices(to));
+}
+
+RouterEngine<double>::WeightMatrix TransportRouter::ComputeTravelTimeMatrix(const vector<string_view>& from,
+                                                                            const vector<string_view>& to) const {
+    return ComputeTravelTimeMatrix(GetStopIds(from), GetStopIds(to));
+}
+
+RouterEngine<double>::WeightMatrix TransportRouter::ComputeTravelTimeMatrix(const vector<StopId>& from,
+                                                                            const vector<StopId>& to) const {
+    const auto sources = GetStopVertices(from);
+    VerifyIndexRows(sources);
+    return router_->ComputeWeightMatrix(sources, GetStopVertices(to), *thread_pool_);
+}
 
-        result[identical_stop][identical_stop] = (*distance_from_to / settings_.velocity) * CONVERT_COEF;
+StopId TransportRouter::GetStopId(string_view name_stop) const {
+    const Stop* stop = catalogue_.FindStop(name_stop);
+    if(!stop) {
+        throw std::out_of_range("Stop not in the catalogue"s);
     }
 
-    //Заполняем вес для соседних остановок в маршруте
-    for(size_t stop_from = 0, stop_to = 1; stop_to < stops.size(); ++stop_from, ++stop_to) {
-        auto distance_from_to = catalogue_.FindDistance(stops[stop_from], stops[stop_to]);
-        if(!distance_from_to) {
-            continue;
-        }
-        result[stop_from][stop_to] = (*distance_from_to / settings_.velocity) * CONVERT_COEF;
+    return stop->id;
+}
 
-        auto distance_to_from = catalogue_.FindDistance(stops[stop_to], stops[stop_from]);
-        if(!distance_to_from) {
-            continue;
-        }
-        result[stop_to][stop_from] = (*distance_to_from / settings_.velocity) * CONVERT_COEF;
+vector<StopId> TransportRouter::GetStopIds(const vector<string_view>& names_stops) const {
+    vector<StopId> stop_ids;
+    stop_ids.reserve(names_stops.size());
+
+    for(const auto name_stop : names_stops) {
+        stop_ids.push_back(GetStopId(name_stop));
     }
+    return stop_ids;
+}
 
-    //Заполняем остальные остановки, посредством сложения веса смежных маршрутов
-    //Например 0->5  = 0->4 + 4->5, т.е время на проезд от остановки 0 до 5 равно
-    //сумме на путешествие от 0 остновки до 4 и от 4 до 5 без ожидания
-    for(size_t i = 0; i < stops.size(); ++i) {
-        for(size_t j = 2 + i; j < stops.size(); ++j) {
-            result[i][j] = result[i][j-1] + result[j-1][j];
-            result[j][i] = result[j-1][i] + result[j][j-1]; 
-        }
+VertexId TransportRouter::GetStopVertex(StopId stop_id) const {
+    return stop_vertices_.at(stop_id);
+}
+
+vector<VertexId> TransportRouter::GetStopVertices(const vector<StopId>& stop_ids) const {
+    vector<VertexId> vertices;
+    vertices.reserve(stop_ids.size());
+
+    for(const StopId stop_id : stop_ids) {
+        vertices.push_back(GetStopVertex(stop_id));
+    }
+    return vertices;
+}
+
+double TransportRouter::ComputeRideWeight(const Stop* stop_from, const Stop* stop_to) const {
+    const auto distance = catalogue_.FindDistance(stop_from, stop_to);
+    if(!distance) {
+        return 0.;
+    }
+
+    return (*distance / settings_.velocity) * CONVERT_COEF;
+}
+
+vector<double> TransportRouter::ComputeHopWeights(const StopsRange& stops) const {
+    vector<double> result;
+    if(stops.size() < 2) {
+        return result;
+    }
+
+    result.reserve(stops.size() - 1);
+    for(size_t stop_from = 0, stop_to = 1; stop_to < stops.size(); ++stop_from, ++stop_to) {
+        result.push_back(ComputeRideWeight(stops[stop_from], stops[stop_to]));
     }
 
     return result;
@@ -64,10 +135,11 @@ vector<vector<double>> TransportRouter::ComputeWeightForEdges(const vector<const
 void TransportRouter::AddWaitEdges(const vector<const Stop*>& stops) {
     VertexId current_id = 0;
     VertexId next_id = current_id + 1;
+    stop_vertices_.assign(catalogue_.GetStopsCount(), 0);
     for(const auto& stop : stops) {
-        start_routes_id_.insert({stop->name_stop, current_id});
+        stop_vertices_[stop->id] = current_id;
         route_graph_.AddEdge(BuildEdge<double>()
-                                      .SetName(stop->name_stop)
+                                      .SetName(route_graph_.AddName(stop->name_stop))
                                       .SetIdFrom(current_id++)
                                       .SetIdTo(next_id++)
                                       .SetWeight(settings_.wait_time)
@@ -78,41 +150,672 @@ void TransportRouter::AddWaitEdges(const vector<const Stop*>& stops) {
 }
 
 void TransportRouter::AddBusEdges() {
-    for(const auto& bus : catalogue_.GetBuses(true)) {                               
-        const vector<const Stop*>& stops = bus->stops_for_bus;
-        const auto weight_for_edges = ComputeWeightForEdges(stops);
-
-        for(size_t identical_stop = 0; identical_stop < stops.size(); ++identical_stop) {
-
-            if(weight_for_edges[identical_stop][identical_stop] != 0){
-                route_graph_.AddEdge(BuildEdge<double>()
-                                     .SetName(bus->name_bus)
-                                     .SetIdFrom(start_routes_id_.at(stops[identical_stop]->name_stop))
-                                     .SetIdTo(start_routes_id_.at(stops[identical_stop]->name_stop))
-                                     .SetWeight(weight_for_edges[identical_stop][identical_stop])
-                                     .Build()
-                                    );
-            }
-        }   
-
-        for(size_t stop_from = 0; stop_from < stops.size(); ++stop_from) {
-            
-            for(size_t stop_to = stop_from + 1; stop_to < stops.size(); ++stop_to) {
-                route_graph_.AddEdge(BuildEdge<double>()
-                                     .SetName(bus->name_bus)
-                                     .SetSpanCount(stop_to - stop_from)
-                                     .SetIdFrom(start_routes_id_.at(stops[stop_from]->name_stop) + 1)
-                                     .SetIdTo(start_routes_id_.at(stops[stop_to]->name_stop))
-                                     .SetWeight(weight_for_edges[stop_from][stop_to])
-                                     .Build()
-                                     );
-            }
+    const auto buses = catalogue_.GetBuses(true);
+
+    //Ребра маршрутов считаются независимо и параллельно, каждый в свой буфер. В граф буферы
+    //добавляются в порядке справочника, поэтому id ребер не зависят от числа потоков
+    vector<vector<Edge<double>>> bus_edges(buses.size());
+    //Имена добавляются в таблицу графа заранее: в потоках она только читается
+    for(const auto& bus : buses) {
+        route_graph_.AddName(bus->name_bus);
+    }
+    thread_pool_->ParallelFor(buses.size(), [this, &buses, &bus_edges](size_t i) {
+        bus_edges[i] = CreateBusEdges(*buses[i]);
+    });
+
+    for(auto& edges : bus_edges) {
+        for(const auto& edge : edges) {
+            route_graph_.AddEdge(edge);
+        }
+        edges = {};
+    }
+}
+
+vector<Edge<double>> TransportRouter::CreateBusEdges(const Bus& bus) const {
+    //Ребра-остановки с расстоянием до самой себя в графе RAPTOR не нужны: петля с
+    //положительным весом не бывает частью кратчайшего пути
+    if(settings_.engine == RoutingEngine::RAPTOR) {
+        return CreateBusHopEdges(bus);
+    }
+
+    const StopsRange& stops = bus.stops_for_bus;
+    const auto hop_weights = ComputeHopWeights(stops);
+    const NameId name = route_graph_.GetNameId(bus.name_bus);
+    vector<Edge<double>> edges;
+
+    for(size_t identical_stop = 0; identical_stop < stops.size(); ++identical_stop) {
+        const double weight = ComputeRideWeight(stops[identical_stop], stops[identical_stop]);
+
+        if(weight != 0){
+            edges.push_back(BuildEdge<double>()
+                            .SetName(name)
+                            .SetIdFrom(stop_vertices_[stops[identical_stop]->id])
+                            .SetIdTo(stop_vertices_[stops[identical_stop]->id])
+                            .SetWeight(weight)
+                            .Build()
+                            );
+        }
+    }   
+
+    //Время на проезд от остановки i до j - сумма перегонов i..j без ожидания. Сумма накапливается
+    //слева направо: (i->i+1 + i+1->i+2) + ..., поэтому веса совпадают с прежней матрицей бит в бит
+    for(size_t stop_from = 0; stop_from < stops.size(); ++stop_from) {
+        double weight = 0.;
+
+        for(size_t stop_to = stop_from + 1; stop_to < stops.size(); ++stop_to) {
+            weight += hop_weights[stop_to - 1];
+
+            edges.push_back(BuildEdge<double>()
+                            .SetName(name)
+                            .SetSpanCount(stop_to - stop_from)
+                            .SetIdFrom(stop_vertices_[stops[stop_from]->id] + 1)
+                            .SetIdTo(stop_vertices_[stops[stop_to]->id])
+                            .SetWeight(weight)
+                            .Build()
+                            );
+        }
+    }
+
+    return edges;
+}
+
+vector<Edge<double>> TransportRouter::CreateBusHopEdges(const Bus& bus) const {
+    const StopsRange& stops = bus.stops_for_bus;
+    const auto hop_weights = ComputeHopWeights(stops);
+    const NameId name = route_graph_.GetNameId(bus.name_bus);
+    vector<Edge<double>> edges;
+
+    for(size_t stop_from = 0, stop_to = 1; stop_to < stops.size(); ++stop_from, ++stop_to) {
+        edges.push_back(BuildEdge<double>()
+                        .SetName(name)
+                        .SetSpanCount(1)
+                        .SetIdFrom(stop_vertices_[stops[stop_from]->id] + 1)
+                        .SetIdTo(stop_vertices_[stops[stop_to]->id])
+                        .SetWeight(hop_weights[stop_from])
+                        .Build()
+                        );
+    }
+
+    return edges;
+}
+
+void TransportRouter::IndexBusEdges() {
+    //Ребра ожидания добавлены первыми, за ними ребра маршрутов в порядке справочника,
+    //у каждого ребра маршрута его имя
+    EdgeId edge_id = catalogue_.GetStopsCount();
+    bus_edges_.clear();
+
+    for(const auto& bus : catalogue_.GetBuses(true)) {
+        //У маршрута без ребер имени в таблице графа могло не быть
+        const NameId name = route_graph_.AddName(bus->name_bus);
+        const EdgeId begin = edge_id;
+        while(edge_id < route_graph_.GetEdgeCount() && route_graph_.GetEdge(edge_id).name == name) {
+            ++edge_id;
+        }
+        bus_edges_.push_back({bus->name_bus, begin, edge_id});
+    }
+}
+
+bool TransportRouter::ReplaceBusEdges(size_t bus_index, const vector<Edge<double>>& edges) {
+    BusEdges& bus_edges = bus_edges_[bus_index];
+    const size_t old_size = bus_edges.end - bus_edges.begin;
+
+    //Ребро на том же месте с теми же концами и весом для таблицы ALL_PAIRS осталось прежним
+    vector<bool> is_kept(std::min(old_size, edges.size()));
+    for(size_t i = 0; i < is_kept.size(); ++i) {
+        const auto& old_edge = route_graph_.GetEdge(bus_edges.begin + i);
+        is_kept[i] = old_edge.weight == edges[i].weight && old_edge.from == edges[i].from && old_edge.to == edges[i].to;
+    }
+    if(edges.size() == old_size && std::all_of(is_kept.begin(), is_kept.end(), [](bool kept) { return kept; })) {
+        return false;
+    }
+
+    const EdgeId old_end = bus_edges.end;
+    route_graph_.ReplaceEdges(bus_edges.begin, bus_edges.end, edges);
+
+    bus_edges.end = bus_edges.begin + edges.size();
+    for(size_t i = bus_index + 1; i < bus_edges_.size(); ++i) {
+        bus_edges_[i].begin = bus_edges_[i].begin - old_size + edges.size();
+        bus_edges_[i].end = bus_edges_[i].end - old_size + edges.size();
+    }
+
+    //Таблицу ALL_PAIRS дочиниваем сразу, пока известно, какие ребра заменены. Дочинка не удается,
+    //если в графе есть равные кратчайшие маршруты; тогда таблица устарела, и следующие замены ее не трогают
+    auto repair_table = [&](auto* table_router) {
+        return table_router->RepairReplacedEdges(bus_edges.begin, old_end, bus_edges.end, is_kept, *thread_pool_);
+    };
+    if(needs_router_rebuild_) {
+        return true;
+    }
+    if(auto* table_router = dynamic_cast<Router<double>*>(router_.get())) {
+        needs_router_rebuild_ = !repair_table(table_router);
+    } else if(auto* table_router = dynamic_cast<Router<double, float>*>(router_.get())) {
+        needs_router_rebuild_ = !repair_table(table_router);
+    } else {
+        needs_router_rebuild_ = true;
+    }
+    if(!needs_router_rebuild_) {
+        ++table_repair_count_;
+    }
+
+    return true;
+}
+
+void TransportRouter::RepairRouter() {
+    //Дейкстра ничего не хранит и сразу работает по исправленному графу
+    const bool needs_rebuild = std::exchange(needs_router_rebuild_, false);
+    if(settings_.engine == RoutingEngine::DIJKSTRA) {
+        return;
+    }
+
+    //Таблица ALL_PAIRS обычно уже дочинена в ReplaceBusEdges. Иерархия сжатий и RAPTOR строятся
+    //заново: сокращения и пересадки зависят от весов всего графа
+    if(needs_rebuild) {
+        CreateRouter();
+    }
+
+    //Движок больше не ссылается на таблицу из файла индекса, а сам файл устарел
+    index_file_.reset();
+    verified_index_rows_.clear();
+    is_index_corrupted_ = false;
+}
+
+void TransportRouter::AddBus(string_view name_bus) {
+    CheckCatalogueNotFrozen();
+    const Bus* bus = catalogue_.FindBus(name_bus);
+    if(!bus || catalogue_.GetBusesCount() != bus_edges_.size() + 1 || catalogue_.GetBuses(true).back() != bus) {
+        throw std::invalid_argument("Bus should be the last one added to the catalogue"s);
+    }
+
+    //Вершины есть только у остановок, известных при построении графа
+    for(const Stop* stop : bus->stops_for_bus) {
+        if(stop->id >= stop_vertices_.size()) {
+            throw std::invalid_argument("Bus uses a stop added after the router was built"s);
+        }
+    }
+
+    const EdgeId edge_count = route_graph_.GetEdgeCount();
+    bus_edges_.push_back({bus->name_bus, edge_count, edge_count});
+    route_graph_.AddName(bus->name_bus);
+
+    if(ReplaceBusEdges(bus_edges_.size() - 1, CreateBusEdges(*bus))) {
+        RepairRouter();
+    }
+}
+
+void TransportRouter::RemoveBus(string_view name_bus) {
+    CheckCatalogueNotFrozen();
+    const auto iter = std::find_if(bus_edges_.begin(), bus_edges_.end(), [name_bus](const BusEdges& bus_edges) {
+        return bus_edges.name_bus == name_bus;
+    });
+    if(iter == bus_edges_.end() || catalogue_.FindBus(name_bus)) {
+        throw std::invalid_argument("Bus should be removed from the catalogue"s);
+    }
+
+    const bool changed = ReplaceBusEdges(iter - bus_edges_.begin(), {});
+    bus_edges_.erase(iter);
+    if(changed) {
+        RepairRouter();
+    }
+}
+
+void TransportRouter::UpdateDistance(string_view stop_from, string_view stop_to) {
+    CheckCatalogueNotFrozen();
+    if(!catalogue_.FindStop(stop_to)) {
+        throw std::invalid_argument("Stop not in the catalogue"s);
+    }
+
+    //Расстояние в любую сторону между stop_from и stop_to входит только в маршруты через stop_from
+    const auto buses = catalogue_.FindBusesForStop(stop_from);
+
+    bool changed = false;
+    for(size_t i = 0; i < bus_edges_.size(); ++i) {
+        if(std::binary_search(buses.begin(), buses.end(), string_view(bus_edges_[i].name_bus))) {
+            const Bus* bus = catalogue_.FindBus(bus_edges_[i].name_bus);
+            changed = ReplaceBusEdges(i, CreateBusEdges(*bus)) || changed;
+        }
+    }
+
+    if(changed) {
+        RepairRouter();
+    }
+}
+
+void TransportRouter::CheckCatalogueNotFrozen() const {
+    if(catalogue_.IsFrozen()) {
+        throw std::logic_error("Incremental updates need an unfrozen catalogue"s);
+    }
+}
+
+vector<vector<EdgeId>> TransportRouter::CreateBusLines() const {
+    //Ребра ожидания добавлены первыми, за ними перегоны маршрутов в порядке справочника
+    EdgeId edge_id = catalogue_.GetStopsCount();
+    vector<vector<EdgeId>> lines;
+
+    for(const auto& bus : catalogue_.GetBuses(true)) {
+        vector<EdgeId> line;
+        for(size_t stop_to = 1; stop_to < bus->stops_for_bus.size(); ++stop_to) {
+            line.push_back(edge_id++);
         }
+        lines.push_back(std::move(line));
     }
+
+    return lines;
 }
 
 void TransportRouter::CreateGraph() {
     AddWaitEdges(catalogue_.GetStops(true));     
     AddBusEdges();
+    route_graph_.Freeze();
+}
+
+void TransportRouter::CreateRouter() {
+    switch (settings_.engine) {
+        case RoutingEngine::DIJKSTRA:
+            router_ = std::make_unique<DijkstraRouter<double>>(route_graph_);
+            break;
+
+        case RoutingEngine::CONTRACTION_HIERARCHY:
+            router_ = std::make_unique<ContractionHierarchyRouter<double>>(route_graph_);
+            break;
+
+        case RoutingEngine::ASTAR:
+            router_ = std::make_unique<AStarRouter<double>>(route_graph_, CreateGeoLowerBound());
+            break;
+
+        case RoutingEngine::RAPTOR:
+            router_ = std::make_unique<RaptorRouter<double>>(route_graph_, CreateBusLines());
+            break;
+
+        case RoutingEngine::ALL_PAIRS:
+            [[fallthrough]];
+        default:
+            router_ = CreateTableRouter();
+            break;
+    }
+}
+
+std::unique_ptr<RouterEngine<double>> TransportRouter::CreateTableRouter() const {
+    if(settings_.float_route_table) {
+        return std::make_unique<Router<double, float>>(route_graph_, *thread_pool_, settings_.route_table_tolerance);
+    }
+
+    return std::make_unique<Router<double>>(route_graph_, *thread_pool_);
+}
+
+AStarRouter<double>::LowerBound TransportRouter::CreateGeoLowerBound() const {
+    //Вершины 2i и 2i + 1 относятся к i-й остановке
+    vector<geo::PreparedCoordinates> coordinates;
+    for(const auto& stop : catalogue_.GetStops(true)) {
+        coordinates.push_back(stop->prepared_coordinates);
+    }
+
+    auto geo_distance = [](const geo::PreparedCoordinates& from, const geo::PreparedCoordinates& to) {
+        const double distance = geo::ComputeDistance(from, to);
+        //Для совпадающих точек acos от округленного аргумента может дать NaN
+        return distance > 0 ? distance : 0.;
+    };
+
+    //Минутам на метр по прямой соответствует отношение длины по дорогам к длине по сфере
+    //(извилистость из BusInfo), деленное на скорость. Средняя извилистость
+    //маршрута не годится для оценки снизу: отдельный перегон может быть и прямее. Поэтому
+    //берется минимум по всем перегонам, то есть по ребрам длиной в одну остановку
+    std::optional<double> minutes_per_meter;
+    for(EdgeId edge_id = 0; edge_id < route_graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = route_graph_.GetEdge(edge_id);
+        if(edge.span_count != 1) {
+            continue;
+        }
+
+        const double distance = geo_distance(coordinates[edge.from / 2], coordinates[edge.to / 2]);
+        if(distance > 0 && (!minutes_per_meter || edge.weight / distance < *minutes_per_meter)) {
+            minutes_per_meter = edge.weight / distance;
+        }
+    }
+
+    //Запас на погрешность округления, чтобы оценка не превысила точный вес пути
+    const double factor = minutes_per_meter.value_or(0.) * (1. - 1e-9);
+
+    return [coordinates = std::move(coordinates), factor, geo_distance](VertexId vertex, VertexId to) {
+        if(factor == 0. || vertex / 2 == to / 2) {
+            return 0.;
+        }
+        return factor * geo_distance(coordinates[vertex / 2], coordinates[to / 2]);
+    };
+}
+
+string_view TransportRouter::GetEdgeName(const Edge<double>& edge) const {
+    return route_graph_.GetName(edge.name);
+}
+
+size_t TransportRouter::GetRouterMemoryFootprint() const {
+    return router_->GetMemoryFootprint();
+}
+
+size_t TransportRouter::GetTableRepairCount() const {
+    return table_repair_count_;
+}
+
+uint64_t TransportRouter::ComputeIndexChecksum() const {
+    routing_index::Checksum checksum;
+
+    //Порядок остановок задает номера вершин графа
+    for(const auto& stop : catalogue_.GetStops(true)) {
+        checksum.Add(stop->name_stop);
+        checksum.AddValue(stop->coordinates.lat);
+        checksum.AddValue(stop->coordinates.lng);
+    }
+
+    //Расстояния, от которых зависят веса ребер маршрутов, с запасом: и в обратную сторону
+    auto add_distance = [this, &checksum](const Stop* stop_from, const Stop* stop_to) {
+        const auto distance = catalogue_.FindDistance(stop_from, stop_to);
+        checksum.AddValue(distance.has_value());
+        checksum.AddValue(distance.value_or(0.));
+    };
+
+    for(const auto& bus : catalogue_.GetBuses(true)) {
+        const auto& stops = bus->stops_for_bus;
+
+        checksum.Add(bus->name_bus);
+        checksum.AddValue(bus->is_roundtrip);
+        checksum.AddValue(static_cast<uint64_t>(stops.size()));
+
+        for(size_t i = 0; i < stops.size(); ++i) {
+            checksum.Add(stops[i]->name_stop);
+            add_distance(stops[i], stops[i]);
+
+            if(i + 1 < stops.size()) {
+                add_distance(stops[i], stops[i + 1]);
+                add_distance(stops[i + 1], stops[i]);
+            }
+        }
+    }
+
+    checksum.AddValue(settings_.wait_time);
+    checksum.AddValue(settings_.velocity);
+    checksum.AddValue(settings_.engine);
+    checksum.AddValue(settings_.float_route_table);
+    checksum.AddValue(settings_.route_table_tolerance);
+
+    return checksum.Get();
+}
+
+void TransportRouter::SaveIndex(const string& path) const {
+    using namespace routing_index;
+
+    FileBuilder builder;
+
+    //Имена ребер повторяются (имя маршрута на каждом его ребре), в файл пишем каждое один раз
+    string strings;
+    std::map<string_view, uint64_t> string_offsets;
+    auto add_string = [&strings, &string_offsets](string_view str) {
+        const auto [iter, inserted] = string_offsets.emplace(str, strings.size());
+        if(inserted) {
+            strings += str;
+        }
+        return iter->second;
+    };
+
+    vector<EdgeRecord> edges;
+    edges.reserve(route_graph_.GetEdgeCount());
+    for(EdgeId edge_id = 0; edge_id < route_graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = route_graph_.GetEdge(edge_id);
+        const string_view name = route_graph_.GetName(edge.name);
+        edges.push_back({add_string(name), name.size(), edge.span_count, edge.from, edge.to, edge.weight});
+    }
+
+    vector<StopRecord> stops;
+    stops.reserve(stop_vertices_.size());
+    for(StopId stop_id = 0; stop_id < stop_vertices_.size(); ++stop_id) {
+        const string_view name = catalogue_.FindStop(stop_id)->name_stop;
+        stops.push_back({add_string(name), name.size(), stop_vertices_[stop_id]});
+    }
+
+    const Section strings_section = builder.AddSection(strings.data(), strings.size());
+    const Section edges_section = builder.AddSection(edges.data(), edges.size() * sizeof(EdgeRecord));
+    const Section stops_section = builder.AddSection(stops.data(), stops.size() * sizeof(StopRecord));
+
+    const size_t vertex_count = route_graph_.GetVertexCount();
+    const size_t cell_count = vertex_count * vertex_count;
+    Section weights_section;
+    Section prev_edges_section;
+    Section row_checksums_section;
+    uint32_t table_weight_size = 0;
+
+    auto add_table = [&](const auto* table_router) {
+        using TableRouter = std::remove_pointer_t<decltype(table_router)>;
+        const auto* weights = table_router->GetTableWeights();
+        const auto* prev_edges = table_router->GetTablePrevEdges();
+
+        table_weight_size = sizeof(*weights);
+        weights_section = builder.AddSection(weights, cell_count * sizeof(*weights));
+        prev_edges_section = builder.AddSection(prev_edges, cell_count * sizeof(typename TableRouter::PrevEdge));
+
+        vector<uint64_t> row_checksums(vertex_count);
+        for(VertexId row = 0; row < vertex_count; ++row) {
+            row_checksums[row] = ComputeIndexRowChecksum(reinterpret_cast<const char*>(weights),
+                                                         reinterpret_cast<const char*>(prev_edges),
+                                                         table_weight_size, row);
+        }
+        row_checksums_section = builder.AddSection(row_checksums.data(), vertex_count * sizeof(uint64_t));
+    };
+
+    if(const auto* table_router = dynamic_cast<const Router<double>*>(router_.get())) {
+        add_table(table_router);
+    } else if(const auto* table_router = dynamic_cast<const Router<double, float>*>(router_.get())) {
+        add_table(table_router);
+    } else {
+        throw std::logic_error("Routing index is saved only for ALL_PAIRS engine"s);
+    }
+
+    Header& header = builder.GetHeader();
+    header.checksum = ComputeIndexChecksum();
+    header.graph_checksum = ComputeSectionsChecksum(builder.GetData(), {strings_section, edges_section, stops_section});
+    header.table_checksum = ComputeSectionsChecksum(builder.GetData(), {weights_section, prev_edges_section});
+    header.vertex_count = vertex_count;
+    header.engine = static_cast<uint32_t>(settings_.engine);
+    header.table_weight_size = table_weight_size;
+    header.strings = strings_section;
+    header.edges = edges_section;
+    header.stops = stops_section;
+    header.table_weights = weights_section;
+    header.table_prev_edges = prev_edges_section;
+    header.table_row_checksums = row_checksums_section;
+
+    builder.Write(path);
+}
+
+bool TransportRouter::TryLoadIndex() {
+    using namespace routing_index;
+
+    //Из файла берется только таблица ALL_PAIRS, остальные движки строятся по графу заново
+    if(settings_.index_path.empty() || settings_.engine != RoutingEngine::ALL_PAIRS) {
+        return false;
+    }
+
+    auto file = std::make_unique<MappedFile>(settings_.index_path);
+    if(!file->IsOpen() || file->GetSize() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file->GetData(), sizeof(Header));
+
+    const size_t vertex_count = catalogue_.GetStopsCount() * 2;
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+       || header.version != FORMAT_VERSION
+       || header.header_size != sizeof(Header)
+       || header.vertex_count != vertex_count
+       || header.engine != static_cast<uint32_t>(settings_.engine)
+       || header.checksum != ComputeIndexChecksum()) {
+        return false;
+    }
+
+    const char* strings = file->GetSection(header.strings);
+    const char* edges_data = file->GetSection(header.edges);
+    const char* stops_data = file->GetSection(header.stops);
+    if(!strings || !edges_data || !stops_data
+       || header.edges.size % sizeof(EdgeRecord) != 0
+       || header.stops.size != catalogue_.GetStopsCount() * sizeof(StopRecord)) {
+        return false;
+    }
+
+    //Граф и вершины остановок малы и проверяются сразу. Таблицу целиком проверяет только
+    //VerifyTableChecksum, иначе каждая строка сверяется со своей суммой перед первым запросом к ней
+    const uint64_t graph_checksum = ComputeSectionsChecksum(file->GetData(),
+                                                            {header.strings, header.edges, header.stops});
+    if(header.graph_checksum != graph_checksum) {
+        return false;
+    }
+
+    //Таблица ALL_PAIRS обязана быть в файле: ради нее индекс и нужен
+    const size_t cell_count = vertex_count * vertex_count;
+    const size_t weight_size = settings_.float_route_table ? sizeof(float) : sizeof(double);
+    const char* weights = file->GetSection(header.table_weights);
+    const char* prev_edges = file->GetSection(header.table_prev_edges);
+
+    if(header.table_weight_size != weight_size || !weights || !prev_edges
+       || !file->GetSection(header.table_row_checksums)
+       || header.table_weights.size != cell_count * weight_size
+       || header.table_prev_edges.size != cell_count * sizeof(Router<double>::PrevEdge)
+       || header.table_row_checksums.size != vertex_count * sizeof(uint64_t)) {
+        return false;
+    }
+
+    if(settings_.verify_index_table && !VerifyTableChecksum(*file)) {
+        return false;
+    }
+
+    const size_t edge_count = header.edges.size / sizeof(EdgeRecord);
+    const auto* table_prev_edges = reinterpret_cast<const Router<double>::PrevEdge*>(prev_edges);
+
+    auto read_string = [&header, strings](uint64_t offset, uint64_t size) -> std::optional<string_view> {
+        if(offset > header.strings.size || size > header.strings.size - offset) {
+            return std::nullopt;
+        }
+        return string_view(strings + offset, size);
+    };
+
+    DirectedWeightedGraph<double> route_graph(vertex_count);
+    const auto* edges = reinterpret_cast<const EdgeRecord*>(edges_data);
+    for(size_t i = 0; i < edge_count; ++i) {
+        const auto name = read_string(edges[i].name_offset, edges[i].name_size);
+        if(!name || edges[i].from >= vertex_count || edges[i].to >= vertex_count
+           || edges[i].span_count > std::numeric_limits<uint32_t>::max()) {
+            return false;
+        }
+
+        route_graph.AddEdge(BuildEdge<double>()
+                            .SetName(route_graph.AddName(*name))
+                            .SetSpanCount(edges[i].span_count)
+                            .SetIdFrom(edges[i].from)
+                            .SetIdTo(edges[i].to)
+                            .SetWeight(edges[i].weight)
+                            .Build());
+    }
+
+    vector<VertexId> stop_vertices(catalogue_.GetStopsCount(), vertex_count);
+    const auto* stops = reinterpret_cast<const StopRecord*>(stops_data);
+    for(size_t i = 0; i < catalogue_.GetStopsCount(); ++i) {
+        const auto name = read_string(stops[i].name_offset, stops[i].name_size);
+        const Stop* stop = name ? catalogue_.FindStop(*name) : nullptr;
+        if(!stop || stops[i].vertex >= vertex_count) {
+            return false;
+        }
+        stop_vertices[stop->id] = stops[i].vertex;
+    }
+
+    //Каждая остановка справочника должна получить вершину
+    if(std::find(stop_vertices.begin(), stop_vertices.end(), vertex_count) != stop_vertices.end()) {
+        return false;
+    }
+
+    route_graph.Freeze();
+    route_graph_ = std::move(route_graph);
+    stop_vertices_ = std::move(stop_vertices);
+
+    if(settings_.float_route_table) {
+        router_ = std::make_unique<Router<double, float>>(route_graph_, reinterpret_cast<const float*>(weights),
+                                                          table_prev_edges, settings_.route_table_tolerance);
+    } else {
+        router_ = std::make_unique<Router<double>>(route_graph_, reinterpret_cast<const double*>(weights),
+                                                   table_prev_edges);
+    }
+    index_file_ = std::move(file);
+    //Таблица, целиком сверенная с суммой при загрузке, построчно не проверяется
+    verified_index_rows_ = vector<std::atomic<bool>>(vertex_count);
+    for(auto& is_verified : verified_index_rows_) {
+        is_verified = settings_.verify_index_table;
+    }
+
+    return true;
+}
+
+void TransportRouter::TrySaveIndex() const {
+    if(settings_.index_path.empty() || settings_.engine != RoutingEngine::ALL_PAIRS) {
+        return;
+    }
+
+    try {
+        SaveIndex(settings_.index_path);
+    } catch(const std::exception& err) {
+        std::cerr << err.what() << '\n';
+    }
+}
+
+uint64_t TransportRouter::ComputeIndexRowChecksum(const char* weights, const char* prev_edges, size_t weight_size,
+                                                  VertexId row) const {
+    const size_t vertex_count = route_graph_.GetVertexCount();
+    const size_t prev_edge_size = sizeof(Router<double>::PrevEdge);
+
+    return routing_index::ComputeTableRowChecksum(weights + row * vertex_count * weight_size, vertex_count * weight_size,
+                                                  prev_edges + row * vertex_count * prev_edge_size,
+                                                  vertex_count * prev_edge_size);
+}
+
+void TransportRouter::VerifyIndexRows(const vector<VertexId>& rows) const {
+    using namespace routing_index;
+
+    if(!index_file_) {
+        return;
+    }
+    if(is_index_corrupted_) {
+        throw CorruptedIndexError("Routing index table is corrupted"s);
+    }
+
+    Header header;
+    std::memcpy(&header, index_file_->GetData(), sizeof(Header));
+    const char* weights = index_file_->GetSection(header.table_weights);
+    const char* prev_edges = index_file_->GetSection(header.table_prev_edges);
+    const char* row_checksums = index_file_->GetSection(header.table_row_checksums);
+
+    for(const VertexId row : rows) {
+        if(verified_index_rows_[row]) {
+            continue;
+        }
+
+        uint64_t row_checksum;
+        std::memcpy(&row_checksum, row_checksums + row * sizeof(uint64_t), sizeof(uint64_t));
+
+        if(row_checksum != ComputeIndexRowChecksum(weights, prev_edges, header.table_weight_size, row)) {
+            is_index_corrupted_ = true;
+            throw CorruptedIndexError("Routing index table is corrupted"s);
+        }
+
+        verified_index_rows_[row] = true;
+    }
+}
+
+void TransportRouter::RepairIndex() {
+    if(!index_file_) {
+        return;
+    }
+
+    //Граф из файла проверен при загрузке, по нему таблица считается так же, как без индекса
+    router_ = CreateTableRouter();
+    index_file_.reset();
+    verified_index_rows_.clear();
+    is_index_corrupted_ = false;
+    TrySaveIndex();
 }
 }//namespace router
\ No newline at end of file
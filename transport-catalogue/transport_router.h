@@ -1,21 +1,53 @@
 #pragma once
 
+#include <atomic>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <memory>
 #include <vector>
 #include <unordered_map>
 
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
 #include "domain.h"
 #include "graph.h"
+#include "raptor_router.h"
 #include "router.h"
+#include "routing_index.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
 
 namespace router {
+enum class RoutingEngine {
+    ALL_PAIRS,  //Предрасчет всех маршрутов при старте, запрос за O(длина маршрута)
+    DIJKSTRA,   //Без предрасчета, каждый запрос считается алгоритмом Дейкстры
+    CONTRACTION_HIERARCHY,  //Предрасчет иерархии сжатий, запрос - двунаправленный поиск вверх по иерархии
+    ASTAR,      //Без предрасчета, запрос - A* с оценкой по расстоянию между остановками на сфере
+    RAPTOR,     //Граф из ребер-перегонов, запрос - поиск по раундам пересадок вдоль маршрутов
+};
+
+//Преобразует значение "routing_engine" из routing_settings в RoutingEngine
+RoutingEngine ParseRoutingEngine(std::string_view name);
+
 struct SettingsTransportRouter {
     int wait_time;
     double velocity;
+    RoutingEngine engine = RoutingEngine::ALL_PAIRS;
+    size_t thread_count = 0;  //Потоки для построения графа и таблицы ALL_PAIRS, 0 - по числу ядер
+    bool float_route_table = false;  //Хранить веса таблицы ALL_PAIRS во float вместо double
+    double route_table_tolerance = 1e-6;  //Допустимая относительная погрешность весов во float
+    std::string index_path;  //Файл предрасчитанного индекса ALL_PAIRS, пустая строка - не использовать
+    bool verify_index_table = false;  //Сверять таблицу индекса с контрольной суммой при загрузке
+};
+
+//Строка таблицы из файла индекса не совпала со своей контрольной суммой. Индекс помечается
+//поврежденным, и до TransportRouter::RepairIndex запросы к движку бросают это же исключение
+class CorruptedIndexError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
 };
 
 class TransportRouter {
@@ -25,28 +57,145 @@ public:
                     const TransportCatalogue& catalogue)
                     : catalogue_(catalogue),
                       route_graph_(catalogue.GetStopsCount() * 2),
-                      settings_(settings) {
-        CreateGraph();
-        router_ = std::make_unique<graph::Router<double>>(route_graph_);
+                      settings_(settings),
+                      thread_pool_(std::make_unique<parallel::ThreadPool>(settings.thread_count)) {
+        //Актуальный индекс с диска заменяет построение графа и предрасчет маршрутов
+        if(!TryLoadIndex()) {
+            CreateGraph();
+            CreateRouter();
+            TrySaveIndex();
+        }
+        IndexBusEdges();
     };
 
-    const std::optional<graph::Router<double>::RouteInfo> BuildOptimazedRoute(std::string_view from,
-                                                                              std::string_view to) const;   
+    //Перегрузки по именам переводят их в id один раз и вызывают перегрузки по id.
+    //Неизвестная остановка - исключение std::out_of_range
+    const std::optional<graph::RouterEngine<double>::RouteInfo> BuildOptimazedRoute(std::string_view from,
+                                                                              std::string_view to) const;
+    const std::optional<graph::RouterEngine<double>::RouteInfo> BuildOptimazedRoute(domain::StopId from,
+                                                                              domain::StopId to) const;
+
+    //Маршруты из одной остановки во все остановки to за один проход движка, в порядке to
+    std::vector<std::optional<graph::RouterEngine<double>::RouteInfo>> BuildOptimazedRoutes(
+        std::string_view from, const std::vector<std::string_view>& to) const;
+    std::vector<std::optional<graph::RouterEngine<double>::RouteInfo>> BuildOptimazedRoutes(
+        domain::StopId from, const std::vector<domain::StopId>& to) const;
+
+    //Время в пути для всех пар остановок from x to: строка на каждую остановку from,
+    //nullopt - маршрута нет. Строки считаются параллельно в settings_.thread_count потоков общего пула
+    graph::RouterEngine<double>::WeightMatrix ComputeTravelTimeMatrix(
+        const std::vector<std::string_view>& from, const std::vector<std::string_view>& to) const;
+    graph::RouterEngine<double>::WeightMatrix ComputeTravelTimeMatrix(
+        const std::vector<domain::StopId>& from, const std::vector<domain::StopId>& to) const;
+
+    //Обновления после изменения справочника. Ребра затронутых маршрутов правятся в графе на месте,
+    //и граф получается таким же, как построенный заново. В таблице ALL_PAIRS пересчитываются только
+    //строки, которых касаются замененные ребра: их маршруты выбираются заново, а веса складываются
+    //в том же порядке, что и при построении с нуля. Если в графе есть равные по весу кратчайшие
+    //маршруты, таблица считается заново: дочинка выбрала бы из них не тот, что Флойд-Уоршелл.
+    //Иерархия сжатий и RAPTOR всегда строятся по графу целиком.
+    //Справочник при этом должен быть не заморожен, иначе его нельзя изменить, и методы бросают
+    //logic_error. JSONReader замораживает справочник после загрузки и эти методы не вызывает
+    void AddBus(std::string_view name_bus);     //Маршрут уже добавлен в справочник последним, его
+                                                //остановки были в справочнике при построении роутера
+    void RemoveBus(std::string_view name_bus);  //Маршрут уже удален из справочника
+    void UpdateDistance(std::string_view stop_from, std::string_view stop_to);
+
+    //Имя остановки у ребра ожидания, имя маршрута у ребра поездки
+    std::string_view GetEdgeName(const graph::Edge<double>& edge) const;
+
+    //Память в байтах, занятая данными движка маршрутизации
+    size_t GetRouterMemoryFootprint() const;
+
+    //Число замен ребер маршрутов, после которых таблица ALL_PAIRS дочинена на месте, без расчета заново
+    size_t GetTableRepairCount() const;
+
+    //Строит таблицу ALL_PAIRS по графу вместо поврежденной таблицы из файла индекса и перезаписывает
+    //файл. Вызывается после CorruptedIndexError, пока других запросов к роутеру нет
+    void RepairIndex();
+
+    //Сохраняет граф, вершины остановок и предрасчитанную таблицу маршрутов в файл индекса.
+    //Только для движка ALL_PAIRS, для остальных бросает logic_error
+    void SaveIndex(const std::string& path) const;
 
 private:
+    //Ребра маршрута в графе идут подряд: [begin, end)
+    struct BusEdges {
+        std::string name_bus;
+        graph::EdgeId begin;
+        graph::EdgeId end;
+    };
+
     const TransportCatalogue& catalogue_;
 
-    std::unordered_map<std::string, graph::VertexId> start_routes_id_; 
+    std::vector<graph::VertexId> stop_vertices_;  //Вершина начала ожидания для каждого StopId
     graph::DirectedWeightedGraph<double> route_graph_;
     SettingsTransportRouter settings_;
-    std::unique_ptr<graph::Router<double>> router_ = nullptr;
+    //Один пул на построение графа и все матрицы времени в пути. Вызовы ParallelFor не должны
+    //пересекаться, поэтому ComputeTravelTimeMatrix нельзя вызывать из нескольких потоков сразу
+    std::unique_ptr<parallel::ThreadPool> thread_pool_ = nullptr;
+    //Отображенный файл индекса должен пережить router_, который может ссылаться на его таблицу
+    std::unique_ptr<routing_index::MappedFile> index_file_ = nullptr;
+    std::unique_ptr<graph::RouterEngine<double>> router_ = nullptr;
+    //Строки таблицы из файла, уже сверенные с суммами. Флаги атомарны: const-запросы
+    //из разных потоков сверяют строки независимо, повторная сверка строки безвредна
+    mutable std::vector<std::atomic<bool>> verified_index_rows_;
+    mutable std::atomic<bool> is_index_corrupted_ = false;
+    std::vector<BusEdges> bus_edges_;  //В порядке маршрутов справочника
+    bool needs_router_rebuild_ = false;  //Граф изменился, а движок по нему не дочинен
+    size_t table_repair_count_ = 0;
 
-    //Создает весовую матрицу для маршрутов
-    std::vector<std::vector<double>> ComputeWeightForEdges(const std::vector<const domain::Stop*>& stops);
+    domain::StopId GetStopId(std::string_view name_stop) const;
+    std::vector<domain::StopId> GetStopIds(const std::vector<std::string_view>& names_stops) const;
+    graph::VertexId GetStopVertex(domain::StopId stop_id) const;
+    std::vector<graph::VertexId> GetStopVertices(const std::vector<domain::StopId>& stop_ids) const;
+
+    //Время в пути между остановками по расстоянию из справочника, 0 - расстояние не задано
+    double ComputeRideWeight(const domain::Stop* stop_from, const domain::Stop* stop_to) const;
+    //Время на каждом перегоне маршрута: элемент i - от остановки i до i + 1
+    std::vector<double> ComputeHopWeights(const domain::StopsRange& stops) const;
 
     void AddWaitEdges(const std::vector<const domain::Stop*>& stops);
     void AddBusEdges();
 
-    void CreateGraph();   
+    //Ребра маршрута в том порядке, в котором они лежат в графе
+    std::vector<graph::Edge<double>> CreateBusEdges(const domain::Bus& bus) const;
+    //По ребру на каждый перегон маршрута, для RAPTOR
+    std::vector<graph::Edge<double>> CreateBusHopEdges(const domain::Bus& bus) const;
+
+    //Находит в готовом графе ребра каждого маршрута
+    void IndexBusEdges();
+
+    //Заменяет ребра маршрута bus_index на edges и дочинивает таблицу ALL_PAIRS.
+    //Возвращает false, если ребра не изменились
+    bool ReplaceBusEdges(size_t bus_index, const std::vector<graph::Edge<double>>& edges);
+    //Пересобирает движок после изменения графа, если его не удалось дочинить
+    void RepairRouter();
+    void CheckCatalogueNotFrozen() const;
+
+    //Линии RAPTOR: id ребер-перегонов каждого маршрута по порядку
+    std::vector<std::vector<graph::EdgeId>> CreateBusLines() const;
+
+    void CreateGraph();
+    void CreateRouter();
+    //Движок ALL_PAIRS с таблицей, рассчитанной по графу
+    std::unique_ptr<graph::RouterEngine<double>> CreateTableRouter() const;
+
+    //Нижняя оценка времени в пути между вершинами по расстоянию между их остановками на сфере
+    graph::AStarRouter<double>::LowerBound CreateGeoLowerBound() const;
+
+    //Контрольная сумма данных справочника и настроек, от которых зависят граф и таблица маршрутов
+    uint64_t ComputeIndexChecksum() const;
+
+    //false, если индекс не задан, отсутствует, поврежден или построен по другим данным
+    bool TryLoadIndex();
+    void TrySaveIndex() const;
+
+    //Контрольная сумма строки row таблицы маршрутов с весами размера weight_size
+    uint64_t ComputeIndexRowChecksum(const char* weights, const char* prev_edges, size_t weight_size,
+                                     graph::VertexId row) const;
+    //Сверяет еще не проверенные строки таблицы из файла индекса с их суммами. При несовпадении
+    //помечает индекс поврежденным и бросает CorruptedIndexError, сам роутер не меняется
+    void VerifyIndexRows(const std::vector<graph::VertexId>& rows) const;
 };
 }//namespace router
\ No newline at end of file